@@ -12,15 +12,28 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <assert.h>
+#include <fcntl.h>
 #include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 const rgb_color_t BLACK = (rgb_color_t){.r = 0.0, .g = 0.0, .b = 0.0};
 const rgb_color_t WHITE = (rgb_color_t){.r = 1.0, .g = 1.0, .b = 1.0};
 const rgb_color_t GREEN = (rgb_color_t){.r = 0, .g = 1.0, .b = 0};
 const rgb_color_t RED = (rgb_color_t){.r = 1.0, .g = 0, .b = 0};
+const SDL_Color BLACK_SDL = (SDL_Color){.r = 0, .g = 0, .b = 0, .a = 255};
 
 // window constants
 const vector_t WINDOW = (vector_t){.x = 1000, .y = 500};
@@ -83,6 +96,13 @@ const vector_t CREDITS_LABEL_LOC = (vector_t){.x = 827, .y = 143};
 const vector_t HEALTH_LABEL_LOC = (vector_t){.x = 827, .y = 123};
 const double MENU_TEXT_SIZE = 25;
 const double GAME_OVER_TEXT_SIZE = 70;
+const char *FONT_PATH = "assets/digital.ttf";
+const char *LEVEL_LABEL_FORMAT = "Level: %zu";
+const char *CREDITS_LABEL_FORMAT = "Credits: %zu";
+const char *HEALTH_LABEL_FORMAT = "Health: %zu";
+const char *COST_LABEL_FORMAT = "%zu";
+const char *GAME_OVER_MSG = "GAME OVER";
+const size_t MAX_LABEL_LENGTH = 32;
 
 // selection constants
 const size_t NUM_OF_SELECTIONS = 4;
@@ -157,267 +177,2347 @@ const double TWO_PI = 2 * 3.14;
 // y level for the game over message
 const double GAME_OVER_MSG_Y = 400;
 
+// number of bodies the body table has room for before it grows
+const size_t INITIAL_NUM_BODIES = 128;
+const size_t INITIAL_WEAPON_QUEUE = 64; // weapons before the queue grows
+
+// job pool constants
+const size_t DEFAULT_NUM_THREADS = 1; // the browser build has no workers
+const size_t BROAD_PHASE_GRAIN = 16;  // weapons a worker takes at a time
+
+// snapshot constants
+const char SNAPSHOT_MAGIC[8] = "EGGSNAP";
+const uint32_t SNAPSHOT_VERSION = 2;
+
+// fixed step constants
+const double FIXED_DT = 1.0 / 60.0;
+const double MAX_FRAME_TIME = 0.25; // longer frames slow the game down
+
+// recording constants
+const char RECORDING_MAGIC[8] = "EGGREC";
+const uint32_t RECORDING_VERSION = 1;
+const char *RECORDING_PATH = "session.rec";
+
+// profiler constants
+const size_t PROFILE_CAPACITY = 1 << 16; // events kept, a power of two
+const char *PROFILE_PATH = "profile.json";
+const bool SHOW_PROFILE_OVERLAY = false;
+const vector_t PROFILE_OVERLAY_LOC = (vector_t){.x = 10, .y = 20};
+const double PROFILE_OVERLAY_HEIGHT = 10;
+const double PROFILE_OVERLAY_SCALE = 30; // pixels per millisecond
+const double PROFILE_MARKER_WIDTH = 2;
+
+// sleep constants
+const double SLEEP_SPEED = 1;   // bodies slower than this can fall asleep
+const double SLEEP_DELAY = 0.5; // seconds a body has to stay slow to sleep
+
+// swept collision constants
+const double SWEEP_DEPTH = 1; // how far a clamped weapon is pushed into a body
+
 // background constants
 const rgb_color_t SKY_COLOR = (rgb_color_t){.r = 0.725, .g = 0.96, .b = 1};
 
+// body memory constants
+const size_t MEMORY_ALIGNMENT = _Alignof(max_align_t);
+const size_t ARENA_CHUNK_SIZE = 16384; // bytes
+const size_t POOL_CHUNK_OBJECTS = 64;
+const size_t BLOCK_VERTICES = 4;
+
+// what the game's allocations are counted under
+typedef enum {
+  ALLOC_BODIES,    // bodies the game built, whose size only the library knows
+  ALLOC_VERTICES,  // vertices behind the bodies' shapes
+  ALLOC_ROLE_INFO, // body_info_t and contact arrays
+  ALLOC_LISTS,     // shape lists handed to the bodies, counted as pointers
+  ALLOC_TEXT,      // text textures, counted as 4 bytes a pixel
+  ALLOC_BACKING,   // arena and pool chunks that vertices and infos live in
+  NUM_ALLOC_CATEGORIES
+} alloc_category_t;
+
+const char *ALLOC_CATEGORY_NAMES[NUM_ALLOC_CATEGORIES] = {
+    "bodies", "vertices", "role_info", "lists", "text", "backing",
+};
+
+typedef struct alloc_count {
+  size_t live;  // allocations not freed yet
+  size_t bytes; // bytes the live allocations hold
+  size_t total; // allocations made so far
+} alloc_count_t;
+
+// live allocations by category, and bodies with their info and vertices by
+// role. only the thread running the game updates these
+typedef struct alloc_stats {
+  alloc_count_t categories[NUM_ALLOC_CATEGORIES];
+  alloc_count_t *roles; // one per entry in ROLES
+} alloc_stats_t;
+
+void alloc_count_add(alloc_count_t *count, size_t bytes) {
+  count->live++;
+  count->bytes += bytes;
+  count->total++;
+}
+
+void alloc_count_remove(alloc_count_t *count, size_t bytes) {
+  assert(count->live > 0 && count->bytes >= bytes);
+  count->live--;
+  count->bytes -= bytes;
+}
+
+void alloc_stats_add(alloc_stats_t *stats, alloc_category_t category,
+                     size_t bytes) {
+  alloc_count_add(&stats->categories[category], bytes);
+}
+
+void alloc_stats_remove(alloc_stats_t *stats, alloc_category_t category,
+                        size_t bytes) {
+  alloc_count_remove(&stats->categories[category], bytes);
+}
+
+// counts a realloc from old_bytes to new_bytes, where 0 old bytes means the
+// block is new
+void alloc_stats_resize(alloc_stats_t *stats, alloc_category_t category,
+                        size_t old_bytes, size_t new_bytes) {
+  alloc_count_t *count = &stats->categories[category];
+  if (old_bytes == 0) {
+    alloc_count_add(count, new_bytes);
+    return;
+  }
+  assert(count->bytes >= old_bytes);
+  count->bytes = count->bytes - old_bytes + new_bytes;
+  count->total++;
+}
+
+size_t align_size(size_t size) {
+  return (size + MEMORY_ALIGNMENT - 1) / MEMORY_ALIGNMENT * MEMORY_ALIGNMENT;
+}
+
+// a chunk of memory that an arena hands out front to back
+typedef struct arena_chunk {
+  struct arena_chunk *next;
+  size_t used;
+  size_t capacity;
+  max_align_t data[];
+} arena_chunk_t;
+
+// bump allocator for memory that is given back all at once. live counts the
+// bodies still using the arena. once the arena is retired it is reset as soon
+// as the last of them is freed
+typedef struct arena {
+  arena_chunk_t *chunks;
+  arena_chunk_t *current; // chunks after this one are empty
+  size_t live;
+  bool retired;
+  alloc_stats_t *stats;
+} arena_t;
+
+arena_t *arena_init(alloc_stats_t *stats) {
+  arena_t *arena = calloc(1, sizeof(arena_t));
+  assert(arena != NULL);
+  arena->stats = stats;
+  return arena;
+}
+
+void arena_free(void *arena) {
+  alloc_stats_t *stats = ((arena_t *)arena)->stats;
+  arena_chunk_t *chunk = ((arena_t *)arena)->chunks;
+  while (chunk != NULL) {
+    arena_chunk_t *next = chunk->next;
+    alloc_stats_remove(stats, ALLOC_BACKING,
+                       sizeof(arena_chunk_t) + chunk->capacity);
+    free(chunk);
+    chunk = next;
+  }
+  free(arena);
+}
+
+// keeps every chunk so the next round of allocations needs no mallocs
+void arena_reset(arena_t *arena) {
+  for (arena_chunk_t *chunk = arena->chunks; chunk != NULL;
+       chunk = chunk->next) {
+    chunk->used = 0;
+  }
+  arena->current = arena->chunks;
+}
+
+void *arena_alloc(arena_t *arena, size_t size) {
+  size = align_size(size);
+  arena_chunk_t *chunk = arena->current;
+  while (chunk != NULL && chunk->capacity - chunk->used < size) {
+    chunk = chunk->next;
+  }
+  if (chunk == NULL) {
+    size_t capacity = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+    chunk = malloc(sizeof(arena_chunk_t) + capacity);
+    assert(chunk != NULL);
+    alloc_stats_add(arena->stats, ALLOC_BACKING,
+                    sizeof(arena_chunk_t) + capacity);
+    chunk->used = 0;
+    chunk->capacity = capacity;
+    if (arena->current == NULL) {
+      chunk->next = arena->chunks;
+      arena->chunks = chunk;
+    } else {
+      chunk->next = arena->current->next;
+      arena->current->next = chunk;
+    }
+  }
+  arena->current = chunk;
+  void *ptr = (char *)chunk->data + chunk->used;
+  chunk->used += size;
+  return ptr;
+}
+
+// called when a body holding memory from the arena is freed
+void arena_release(arena_t *arena) {
+  assert(arena->live > 0);
+  arena->live--;
+  if (arena->live == 0 && arena->retired) {
+    arena_reset(arena);
+  }
+}
+
+// the arenas behind one lifetime, such as a level or a wave. only the current
+// arena takes new bodies. the others wait for their bodies to be freed and are
+// then reused
+typedef struct region {
+  list_t *arenas;
+  arena_t *current;
+  alloc_stats_t *stats;
+} region_t;
+
+region_t *region_init(alloc_stats_t *stats) {
+  region_t *region = malloc(sizeof(region_t));
+  assert(region != NULL);
+  region->arenas = list_init(2, arena_free);
+  region->stats = stats;
+  region->current = arena_init(stats);
+  list_add(region->arenas, region->current);
+  return region;
+}
+
+void region_free(region_t *region) {
+  list_free(region->arenas);
+  free(region);
+}
+
+// starts a new lifetime. the current arena is retired, and its memory is
+// reset once the bodies from the old lifetime are gone
+void region_advance(region_t *region) {
+  region->current->retired = true;
+  if (region->current->live == 0) {
+    arena_reset(region->current);
+  }
+  for (size_t i = 0; i < list_size(region->arenas); i++) {
+    arena_t *arena = list_get(region->arenas, i);
+    if (arena->retired && arena->live == 0) {
+      arena->retired = false;
+      region->current = arena;
+      return;
+    }
+  }
+  region->current = arena_init(region->stats);
+  list_add(region->arenas, region->current);
+}
+
+// hands out objects of one size and reuses freed ones before carving more out
+// of a new chunk
+typedef struct pool {
+  size_t object_size;
+  void *free_objects; // each free object holds a pointer to the next one
+  list_t *chunks;
+  alloc_stats_t *stats;
+} pool_t;
+
+pool_t *pool_init(size_t object_size, alloc_stats_t *stats) {
+  pool_t *pool = malloc(sizeof(pool_t));
+  assert(pool != NULL);
+  pool->object_size = align_size(
+      object_size > sizeof(void *) ? object_size : sizeof(void *));
+  pool->free_objects = NULL;
+  pool->chunks = list_init(1, free);
+  pool->stats = stats;
+  return pool;
+}
+
+void pool_free(pool_t *pool) {
+  for (size_t i = 0; i < list_size(pool->chunks); i++) {
+    alloc_stats_remove(pool->stats, ALLOC_BACKING,
+                       pool->object_size * POOL_CHUNK_OBJECTS);
+  }
+  list_free(pool->chunks);
+  free(pool);
+}
+
+void *pool_alloc(pool_t *pool) {
+  if (pool->free_objects == NULL) {
+    char *chunk = malloc(pool->object_size * POOL_CHUNK_OBJECTS);
+    assert(chunk != NULL);
+    alloc_stats_add(pool->stats, ALLOC_BACKING,
+                    pool->object_size * POOL_CHUNK_OBJECTS);
+    list_add(pool->chunks, chunk);
+    for (size_t i = 0; i < POOL_CHUNK_OBJECTS; i++) {
+      void *object = chunk + (i * pool->object_size);
+      *(void **)object = pool->free_objects;
+      pool->free_objects = object;
+    }
+  }
+  void *object = pool->free_objects;
+  pool->free_objects = *(void **)object;
+  return object;
+}
+
+void pool_release(pool_t *pool, void *object) {
+  *(void **)object = pool->free_objects;
+  pool->free_objects = object;
+}
+
+// xorshift64* generator. each game has its own, so games run side by side
+// don't share rand()'s state and a seed always gives the same waves
+typedef struct rng {
+  uint64_t state;
+} rng_t;
+
+void rng_seed(rng_t *rng, uint64_t seed) {
+  // the state must never be zero
+  rng->state = seed ^ 0x9E3779B97F4A7C15ULL;
+  if (rng->state == 0) {
+    rng->state = 1;
+  }
+}
+
+uint32_t rng_next(rng_t *rng) {
+  uint64_t x = rng->state;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  rng->state = x;
+  return (uint32_t)((x * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+// works on the items in [begin, end)
+typedef void (*job_func_t)(void *aux, size_t begin, size_t end);
+
+// the items a thread has left to do in the current run. the owner takes
+// them from the front and other threads steal from the back
+typedef struct job_range {
+  pthread_mutex_t lock;
+  size_t begin;
+  size_t end;
+} job_range_t;
+
+typedef struct job_worker {
+  struct job_pool *pool;
+  size_t id;
+} job_worker_t;
+
+// runs a job over a range of items on a fixed set of threads. the items are
+// split evenly between the threads, and a thread that runs out steals half
+// of what another has left. thread 0 is whoever calls job_pool_run
+typedef struct job_pool {
+  size_t num_threads;
+  pthread_t *threads; // num_threads - 1 workers
+  job_worker_t *workers;
+  job_range_t *ranges; // one per thread
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t idle;
+  size_t generation; // bumped by each run to wake the workers
+  size_t working;    // workers that haven't finished the current run
+  bool stopping;
+  job_func_t func;
+  void *aux;
+  size_t grain;
+} job_pool_t;
+
+// hands a thread its next items, from its own range if it has any left and
+// otherwise by stealing. returns false once there is nothing left to take
+bool job_pool_take(job_pool_t *pool, size_t id, size_t *begin, size_t *end) {
+  job_range_t *own = &pool->ranges[id];
+  pthread_mutex_lock(&own->lock);
+  if (own->begin < own->end) {
+    *begin = own->begin;
+    *end = own->end - own->begin > pool->grain ? own->begin + pool->grain
+                                               : own->end;
+    own->begin = *end;
+    pthread_mutex_unlock(&own->lock);
+    return true;
+  }
+  pthread_mutex_unlock(&own->lock);
+
+  for (size_t i = 1; i < pool->num_threads; i++) {
+    job_range_t *victim = &pool->ranges[(id + i) % pool->num_threads];
+    pthread_mutex_lock(&victim->lock);
+    size_t left = victim->end - victim->begin;
+    if (left == 0) {
+      pthread_mutex_unlock(&victim->lock);
+      continue;
+    }
+    *end = victim->end;
+    *begin = victim->end - ((left + 1) / 2);
+    victim->end = *begin;
+    pthread_mutex_unlock(&victim->lock);
+
+    // keep one grain and leave the rest where it can be stolen in turn
+    if (*end - *begin > pool->grain) {
+      pthread_mutex_lock(&own->lock);
+      own->begin = *begin + pool->grain;
+      own->end = *end;
+      pthread_mutex_unlock(&own->lock);
+      *end = *begin + pool->grain;
+    }
+    return true;
+  }
+  return false;
+}
+
+void job_pool_work(job_pool_t *pool, size_t id) {
+  size_t begin, end;
+  while (job_pool_take(pool, id, &begin, &end)) {
+    pool->func(pool->aux, begin, end);
+  }
+}
+
+void *job_worker_main(void *arg) {
+  job_worker_t *worker = arg;
+  job_pool_t *pool = worker->pool;
+  size_t seen = 0;
+  pthread_mutex_lock(&pool->lock);
+  while (true) {
+    while (pool->generation == seen && pool->stopping == false) {
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    }
+    if (pool->stopping) {
+      break;
+    }
+    seen = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+    job_pool_work(pool, worker->id);
+    pthread_mutex_lock(&pool->lock);
+    pool->working--;
+    if (pool->working == 0) {
+      pthread_cond_signal(&pool->idle);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+// starts num_threads - 1 workers. if a worker can't be started the pool
+// makes do with the ones that were
+job_pool_t *job_pool_init(size_t num_threads) {
+  assert(num_threads > 0);
+  job_pool_t *pool = calloc(1, sizeof(job_pool_t));
+  assert(pool != NULL);
+  pool->threads = malloc(num_threads * sizeof(pthread_t));
+  pool->workers = malloc(num_threads * sizeof(job_worker_t));
+  pool->ranges = calloc(num_threads, sizeof(job_range_t));
+  assert(pool->threads != NULL && pool->workers != NULL &&
+         pool->ranges != NULL);
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+  for (size_t i = 0; i < num_threads; i++) {
+    pthread_mutex_init(&pool->ranges[i].lock, NULL);
+  }
+  pool->num_threads = 1;
+  for (size_t i = 1; i < num_threads; i++) {
+    pool->workers[i] = (job_worker_t){.pool = pool, .id = i};
+    if (pthread_create(&pool->threads[i], NULL, job_worker_main,
+                       &pool->workers[i]) != 0) {
+      break;
+    }
+    pool->num_threads++;
+  }
+  return pool;
+}
+
+void job_pool_free(job_pool_t *pool) {
+  pthread_mutex_lock(&pool->lock);
+  pool->stopping = true;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+  for (size_t i = 1; i < pool->num_threads; i++) {
+    pthread_join(pool->threads[i], NULL);
+  }
+  for (size_t i = 0; i < pool->num_threads; i++) {
+    pthread_mutex_destroy(&pool->ranges[i].lock);
+  }
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->wake);
+  pthread_cond_destroy(&pool->idle);
+  free(pool->threads);
+  free(pool->workers);
+  free(pool->ranges);
+  free(pool);
+}
+
+// calls func on every item in [0, count) and returns once all of them are
+// done. runs on the calling thread alone when there is too little to share
+void job_pool_run(job_pool_t *pool, size_t count, size_t grain,
+                  job_func_t func, void *aux) {
+  assert(grain > 0);
+  if (pool->num_threads == 1 || count <= grain) {
+    if (count > 0) {
+      func(aux, 0, count);
+    }
+    return;
+  }
+  // the workers are all idle, so the ranges can be set without locking
+  size_t num_threads = pool->num_threads;
+  for (size_t i = 0; i < num_threads; i++) {
+    pool->ranges[i].begin = (count * i) / num_threads;
+    pool->ranges[i].end = (count * (i + 1)) / num_threads;
+  }
+  pthread_mutex_lock(&pool->lock);
+  pool->func = func;
+  pool->aux = aux;
+  pool->grain = grain;
+  pool->working = num_threads - 1;
+  pool->generation++;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+
+  job_pool_work(pool, 0);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->working > 0) {
+    pthread_cond_wait(&pool->idle, &pool->lock);
+  }
+  pthread_mutex_unlock(&pool->lock);
+}
+
+// where the game's bodies get their info and vertices from. scenery lasts a
+// level and weapons a wave, so both come from arenas that are dropped in one
+// go. blocks can be removed one at a time, so they come from a pool
+typedef struct body_memory {
+  arena_t *scenery; // bodies that last as long as the game
+  region_t *level;
+  region_t *wave;
+  pool_t *blocks; // info and vertices of a block, back to back
+  alloc_stats_t *stats;
+} body_memory_t;
+
+// names a body in a body table. the index picks a slot, and the generation
+// has to match the slot's, so a handle to a body that is gone never finds
+// whatever body took its slot afterwards
+typedef struct body_handle {
+  uint32_t index;
+  uint32_t generation;
+} body_handle_t;
+
+const body_handle_t NO_BODY = (body_handle_t){.index = UINT32_MAX};
+
+bool body_handle_equal(body_handle_t handle1, body_handle_t handle2) {
+  return handle1.index == handle2.index &&
+         handle1.generation == handle2.generation;
+}
+
+// info attached to every body the game creates. the role must stay the first
+// member so that the info can still be read as a role_t
+typedef struct body_info {
+  role_t role;
+  vector_t *vertices; // contiguous block that backs the body's shape list
+  size_t num_vertices;
+  list_t *shape; // the list handed to the body, which moves it in place
+  body_handle_t handle; // set when the body is added to a body table
+  body_handle_t *contacts; // bodies the broad phase already paired it with
+  size_t num_contacts;
+  size_t contacts_capacity;
+  arena_t *arena; // arena the info and vertices came from, if any
+  pool_t *pool;   // pool they came from otherwise
+  alloc_stats_t *stats; // where the body and its memory are counted
+  const struct shape_prototype *prototype; // shape the body was made from
+  double scale; // how much the prototype was scaled up by
+} body_info_t;
+
+body_memory_t *body_memory_init(alloc_stats_t *stats) {
+  body_memory_t *memory = malloc(sizeof(body_memory_t));
+  assert(memory != NULL);
+  memory->scenery = arena_init(stats);
+  memory->level = region_init(stats);
+  memory->wave = region_init(stats);
+  memory->blocks = pool_init(
+      sizeof(body_info_t) + (BLOCK_VERTICES * sizeof(vector_t)), stats);
+  memory->stats = stats;
+  return memory;
+}
+
+void body_memory_free(body_memory_t *memory) {
+  arena_free(memory->scenery);
+  region_free(memory->level);
+  region_free(memory->wave);
+  pool_free(memory->blocks);
+  free(memory);
+}
+
+// every role a body can have. a role's position in this array keys its set of
+// members in the body table
+const role_t ROLES[] = {BACKGROUND, LAVA, ISLAND, MENU, EGG, GRID_LINE,
+                        PAUSE_PLAY, HIGHLIGHTED_SQUARE, WEAPON,
+                        SELECTION_CIRCLE, HAY, WOOD, STEEL, DIAMOND};
+const size_t NUM_ROLES = sizeof(ROLES) / sizeof(ROLES[0]);
+const role_t BLOCK_ROLES[] = {HAY, WOOD, STEEL, DIAMOND};
+const size_t NUM_BLOCK_ROLES = sizeof(BLOCK_ROLES) / sizeof(BLOCK_ROLES[0]);
+
+bool is_block_role(role_t role) {
+  for (size_t i = 0; i < NUM_BLOCK_ROLES; i++) {
+    if (BLOCK_ROLES[i] == role) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// how the bodies with a role move. static bodies never move or get hit, so
+// they are kept out of the scene. kinematic bodies never move but can be hit
+// and removed. dynamic bodies are integrated
+typedef enum { MOTION_STATIC, MOTION_KINEMATIC, MOTION_DYNAMIC } motion_t;
+
+motion_t role_motion(role_t role) {
+  switch (role) {
+  case BACKGROUND:
+  case LAVA:
+  case ISLAND:
+  case MENU:
+  case GRID_LINE:
+    return MOTION_STATIC;
+  case WEAPON:
+    return MOTION_DYNAMIC;
+  default:
+    return MOTION_KINEMATIC;
+  }
+}
+
+size_t role_slot(role_t role) {
+  for (size_t i = 0; i < NUM_ROLES; i++) {
+    if (ROLES[i] == role) {
+      return i;
+    }
+  }
+  assert(false);
+  return 0;
+}
+
+alloc_stats_t *alloc_stats_init() {
+  alloc_stats_t *stats = calloc(1, sizeof(alloc_stats_t));
+  assert(stats != NULL);
+  stats->roles = calloc(NUM_ROLES, sizeof(alloc_count_t));
+  assert(stats->roles != NULL);
+  return stats;
+}
+
+void alloc_stats_free(alloc_stats_t *stats) {
+  free(stats->roles);
+  free(stats);
+}
+
+// counts a body's info and vertices when they are handed out
+void alloc_stats_add_info(alloc_stats_t *stats, body_info_t *body_info) {
+  size_t vertex_bytes = body_info->num_vertices * sizeof(vector_t);
+  alloc_stats_add(stats, ALLOC_ROLE_INFO, sizeof(body_info_t));
+  alloc_stats_add(stats, ALLOC_VERTICES, vertex_bytes);
+  alloc_count_add(&stats->roles[role_slot(body_info->role)],
+                  sizeof(body_info_t) + vertex_bytes);
+}
+
+// undoes alloc_stats_add_info and the counts of the body and the shape list
+// built around the info, if there is one
+void alloc_stats_remove_info(alloc_stats_t *stats, body_info_t *body_info) {
+  size_t vertex_bytes = body_info->num_vertices * sizeof(vector_t);
+  alloc_stats_remove(stats, ALLOC_ROLE_INFO, sizeof(body_info_t));
+  alloc_stats_remove(stats, ALLOC_VERTICES, vertex_bytes);
+  alloc_count_remove(&stats->roles[role_slot(body_info->role)],
+                     sizeof(body_info_t) + vertex_bytes);
+  if (body_info->shape != NULL) {
+    alloc_stats_remove(stats, ALLOC_BODIES, 0);
+    alloc_stats_remove(stats, ALLOC_LISTS,
+                       body_info->num_vertices * sizeof(vector_t *));
+  }
+  if (body_info->contacts != NULL) {
+    alloc_stats_remove(stats, ALLOC_ROLE_INFO,
+                       body_info->contacts_capacity * sizeof(body_handle_t));
+  }
+}
+
+void body_info_free(void *info) {
+  body_info_t *body_info = info;
+  alloc_stats_remove_info(body_info->stats, body_info);
+  free(body_info->contacts);
+  if (body_info->arena != NULL) {
+    arena_release(body_info->arena);
+  } else {
+    pool_release(body_info->pool, body_info);
+  }
+}
+
+// table indices of the bodies that share a role
+typedef struct role_set {
+  size_t size;
+  size_t capacity;
+  size_t *indices;
+} role_set_t;
+
+void role_set_add(role_set_t *set, size_t index) {
+  if (set->size == set->capacity) {
+    set->capacity = set->capacity == 0 ? 8 : set->capacity * 2;
+    set->indices = realloc(set->indices, set->capacity * sizeof(size_t));
+    assert(set->indices != NULL);
+  }
+  set->indices[set->size] = index;
+  set->size++;
+}
+
+// one body in the scene's order. the body may already be gone from the
+// table, in which case the handle no longer matches its slot
+typedef struct scene_entry {
+  body_t *body;
+  body_handle_t handle;
+} scene_entry_t;
+
+// what a handle's index refers to: the body's table entry while the slot is
+// in use, and the next free slot once it isn't
+typedef struct body_slot {
+  uint32_t generation;
+  uint32_t entry;
+} body_slot_t;
+
+const uint32_t NO_SLOT = UINT32_MAX;
+
+// marks bodies and locations that are not on the building grid
+const size_t NO_GRID_CELL = (size_t)(-1);
+
+// one square of the building grid. the squares are stored row by row
+typedef struct grid_cell {
+  bool occupied;
+  body_handle_t block; // the block or egg body covering the square
+  role_t material; // block role, or EGG for the squares under the egg
+  double health;
+} grid_cell_t;
+
+// structure-of-arrays copy of the body fields read by the per-frame loops.
+// the scene still owns the bodies. the arrays only ever hold live bodies: a
+// body is taken out by moving the last entry into its place, so entries
+// don't keep any order and are named by handles instead of indices. order
+// lists the bodies the way the scene does, so the ones scene_tick freed can
+// be found with one pass of pointer comparisons
+typedef struct body_table {
+  size_t size;
+  size_t capacity;
+  body_t **bodies;
+  role_t *roles;
+  double *masses;
+  double *healths;
+  vector_t *centroids;
+  vector_t *last_centroids; // centroids before the last scene_tick
+  vector_t *velocities;
+  vector_t **vertices;
+  size_t *num_vertices;
+  list_t **shapes;
+  size_t *grid_cells;    // square the body occupies, or NO_GRID_CELL
+  double *rest_times;    // how long a dynamic body has been slow for
+  bool *asleep;          // sleeping bodies get no forces and no contacts
+  body_handle_t *handles;
+  size_t *role_positions; // where each entry sits in its role set
+  role_set_t *role_sets;  // one per entry of ROLES
+  body_slot_t *slots;
+  size_t num_slots;
+  size_t slots_capacity;
+  uint32_t free_slot; // first slot on the free list, or NO_SLOT
+  scene_entry_t *order;
+  size_t order_size;
+  size_t order_capacity;
+  body_handle_t *removals; // bodies to remove at the next flush
+  size_t num_removals;
+  size_t removals_capacity;
+} body_table_t;
+
+// read-only view of a body's world-space vertices. it borrows the body's own
+// storage, so it costs no allocation but is only valid until the body is freed
+// by a scene_tick
+typedef struct shape_view {
+  const vector_t *vertices;
+  size_t size;
+  list_t *points; // the same vertices as a list, for sdl_draw_polygon
+} shape_view_t;
+
+void body_table_reserve(body_table_t *table, size_t capacity) {
+  table->capacity = capacity;
+  table->bodies = realloc(table->bodies, capacity * sizeof(body_t *));
+  table->roles = realloc(table->roles, capacity * sizeof(role_t));
+  table->masses = realloc(table->masses, capacity * sizeof(double));
+  table->healths = realloc(table->healths, capacity * sizeof(double));
+  table->centroids = realloc(table->centroids, capacity * sizeof(vector_t));
+  table->last_centroids =
+      realloc(table->last_centroids, capacity * sizeof(vector_t));
+  table->velocities = realloc(table->velocities, capacity * sizeof(vector_t));
+  table->vertices = realloc(table->vertices, capacity * sizeof(vector_t *));
+  table->num_vertices =
+      realloc(table->num_vertices, capacity * sizeof(size_t));
+  table->shapes = realloc(table->shapes, capacity * sizeof(list_t *));
+  table->grid_cells = realloc(table->grid_cells, capacity * sizeof(size_t));
+  table->rest_times = realloc(table->rest_times, capacity * sizeof(double));
+  table->asleep = realloc(table->asleep, capacity * sizeof(bool));
+  table->handles = realloc(table->handles, capacity * sizeof(body_handle_t));
+  table->role_positions =
+      realloc(table->role_positions, capacity * sizeof(size_t));
+  assert(table->bodies != NULL && table->roles != NULL &&
+         table->masses != NULL && table->healths != NULL &&
+         table->centroids != NULL && table->last_centroids != NULL &&
+         table->velocities != NULL &&
+         table->vertices != NULL && table->num_vertices != NULL &&
+         table->shapes != NULL && table->grid_cells != NULL &&
+         table->rest_times != NULL && table->asleep != NULL &&
+         table->handles != NULL && table->role_positions != NULL);
+}
+
+body_table_t *body_table_init(size_t initial_capacity) {
+  assert(initial_capacity > 0);
+  body_table_t *table = calloc(1, sizeof(body_table_t));
+  assert(table != NULL);
+  table->role_sets = calloc(NUM_ROLES, sizeof(role_set_t));
+  assert(table->role_sets != NULL);
+  table->free_slot = NO_SLOT;
+  body_table_reserve(table, initial_capacity);
+  return table;
+}
+
+void body_table_free(body_table_t *table) {
+  free(table->bodies);
+  free(table->roles);
+  free(table->masses);
+  free(table->healths);
+  free(table->centroids);
+  free(table->last_centroids);
+  free(table->velocities);
+  free(table->vertices);
+  free(table->num_vertices);
+  free(table->shapes);
+  free(table->grid_cells);
+  free(table->rest_times);
+  free(table->asleep);
+  free(table->handles);
+  free(table->role_positions);
+  for (size_t i = 0; i < NUM_ROLES; i++) {
+    free(table->role_sets[i].indices);
+  }
+  free(table->role_sets);
+  free(table->slots);
+  free(table->order);
+  free(table->removals);
+  free(table);
+}
+
+// hands out a slot for a new entry, reusing a freed one if there is one
+body_handle_t body_table_new_handle(body_table_t *table, size_t entry) {
+  uint32_t index = table->free_slot;
+  if (index != NO_SLOT) {
+    table->free_slot = table->slots[index].entry;
+  } else {
+    if (table->num_slots == table->slots_capacity) {
+      table->slots_capacity =
+          table->slots_capacity == 0 ? 16 : table->slots_capacity * 2;
+      table->slots =
+          realloc(table->slots, table->slots_capacity * sizeof(body_slot_t));
+      assert(table->slots != NULL);
+    }
+    assert(table->num_slots < NO_SLOT);
+    index = table->num_slots;
+    table->slots[index].generation = 0;
+    table->num_slots++;
+  }
+  table->slots[index].entry = entry;
+  return (body_handle_t){.index = index,
+                         .generation = table->slots[index].generation};
+}
+
+// returns the table index of a handle's body, or false if the body is gone
+bool body_table_find(body_table_t *table, body_handle_t handle, size_t *idx) {
+  if (handle.index >= table->num_slots ||
+      table->slots[handle.index].generation != handle.generation) {
+    return false;
+  }
+  *idx = table->slots[handle.index].entry;
+  return true;
+}
+
+// returns a handle's body, or NULL if it is gone. anything that keeps a body
+// across ticks should keep its handle and look the body up through here
+body_t *body_table_get(body_table_t *table, body_handle_t handle) {
+  size_t idx;
+  return body_table_find(table, handle, &idx) ? table->bodies[idx] : NULL;
+}
+
+body_handle_t body_table_add(body_table_t *table, body_t *body,
+                             size_t grid_cell) {
+  if (table->size == table->capacity) {
+    body_table_reserve(table, table->capacity * 2);
+  }
+  if (table->order_size == table->order_capacity) {
+    table->order_capacity = table->order_capacity == 0
+                                ? table->capacity
+                                : table->order_capacity * 2;
+    table->order =
+        realloc(table->order, table->order_capacity * sizeof(scene_entry_t));
+    assert(table->order != NULL);
+  }
+  body_info_t *info = body_get_info(body);
+  size_t i = table->size;
+  body_handle_t handle = body_table_new_handle(table, i);
+  info->handle = handle;
+  table->order[table->order_size] =
+      (scene_entry_t){.body = body, .handle = handle};
+  table->order_size++;
+  table->handles[i] = handle;
+  table->bodies[i] = body;
+  table->roles[i] = info->role;
+  table->masses[i] = body_get_mass(body);
+  table->healths[i] = body_get_health(body);
+  table->centroids[i] = body_get_centroid(body);
+  table->last_centroids[i] = table->centroids[i];
+  table->velocities[i] = body_get_velocity(body);
+  table->vertices[i] = info->vertices;
+  table->num_vertices[i] = info->num_vertices;
+  table->shapes[i] = info->shape;
+  table->grid_cells[i] = grid_cell;
+  table->rest_times[i] = 0.0;
+  table->asleep[i] = false;
+  role_set_t *set = &table->role_sets[role_slot(info->role)];
+  table->role_positions[i] = set->size;
+  role_set_add(set, i);
+  table->size++;
+  return handle;
+}
+
+// copies every field of entry from into entry to and points to's slot and
+// role set position at its new place
+void body_table_move(body_table_t *table, size_t from, size_t to) {
+  table->bodies[to] = table->bodies[from];
+  table->roles[to] = table->roles[from];
+  table->masses[to] = table->masses[from];
+  table->healths[to] = table->healths[from];
+  table->centroids[to] = table->centroids[from];
+  table->last_centroids[to] = table->last_centroids[from];
+  table->velocities[to] = table->velocities[from];
+  table->vertices[to] = table->vertices[from];
+  table->num_vertices[to] = table->num_vertices[from];
+  table->shapes[to] = table->shapes[from];
+  table->grid_cells[to] = table->grid_cells[from];
+  table->rest_times[to] = table->rest_times[from];
+  table->asleep[to] = table->asleep[from];
+  table->handles[to] = table->handles[from];
+  table->role_positions[to] = table->role_positions[from];
+  table->slots[table->handles[to].index].entry = to;
+  role_set_t *set = &table->role_sets[role_slot(table->roles[to])];
+  set->indices[table->role_positions[to]] = to;
+}
+
+// wakes the sleeping bodies that could have rested on the block in a grid
+// square: those over its column or the ones beside it, from the row below it
+// up. sleeping bodies get no gravity, so nothing else would make them fall
+// once the block is gone
+void body_table_wake_above(body_table_t *table, size_t cell) {
+  double row = (double)(cell / NUM_GRID_COLS);
+  double col = (double)(cell % NUM_GRID_COLS);
+  double left = GRID_BOTTOM_LEFT.x + ((col - 1) * GRID_SQUARE_WIDTH);
+  double right = GRID_BOTTOM_LEFT.x + ((col + 2) * GRID_SQUARE_WIDTH);
+  double bottom = GRID_BOTTOM_LEFT.y + ((row - 1) * GRID_SQUARE_HEIGHT);
+  for (size_t slot = 0; slot < NUM_ROLES; slot++) {
+    if (role_motion(ROLES[slot]) != MOTION_DYNAMIC) {
+      continue;
+    }
+    role_set_t *set = &table->role_sets[slot];
+    for (size_t i = 0; i < set->size; i++) {
+      size_t idx = set->indices[i];
+      vector_t centroid = table->centroids[idx];
+      if (table->asleep[idx] && centroid.x >= left && centroid.x <= right &&
+          centroid.y >= bottom) {
+        table->asleep[idx] = false;
+        table->rest_times[idx] = 0.0;
+      }
+    }
+  }
+}
+
+// takes entry idx out of the table in constant time by moving the last entry
+// into its place, and retires its handle. the grid square it covered, if it
+// still holds it, is emptied, and whatever slept above it is woken
+void body_table_erase(body_table_t *table, size_t idx, grid_cell_t *grid) {
+  body_handle_t handle = table->handles[idx];
+  size_t cell = table->grid_cells[idx];
+  if (cell != NO_GRID_CELL) {
+    if (body_handle_equal(grid[cell].block, handle)) {
+      grid[cell] = (grid_cell_t){.occupied = false, .block = NO_BODY};
+    }
+    body_table_wake_above(table, cell);
+  }
+
+  role_set_t *set = &table->role_sets[role_slot(table->roles[idx])];
+  size_t position = table->role_positions[idx];
+  size_t moved = set->indices[set->size - 1];
+  set->indices[position] = moved;
+  table->role_positions[moved] = position;
+  set->size--;
+
+  body_slot_t *slot = &table->slots[handle.index];
+  slot->generation++;
+  slot->entry = table->free_slot;
+  table->free_slot = handle.index;
+
+  size_t last = table->size - 1;
+  if (idx != last) {
+    body_table_move(table, last, idx);
+  }
+  table->size--;
+}
+
+// queues a body to be removed at the next body_table_flush. this never moves
+// any entries, so it is safe while walking the table or a role set. queuing
+// a body twice, or one that is already gone, does nothing
+void body_table_remove(body_table_t *table, body_handle_t handle) {
+  if (table->num_removals == table->removals_capacity) {
+    table->removals_capacity =
+        table->removals_capacity == 0 ? 16 : table->removals_capacity * 2;
+    table->removals = realloc(table->removals, table->removals_capacity *
+                                                   sizeof(body_handle_t));
+    assert(table->removals != NULL);
+  }
+  table->removals[table->num_removals] = handle;
+  table->num_removals++;
+}
+
+// removes the queued bodies from the scene and takes them out of the table.
+// the scene frees them on its next tick. called once a tick, before
+// scene_tick
+void body_table_flush(body_table_t *table, grid_cell_t *grid) {
+  for (size_t i = 0; i < table->num_removals; i++) {
+    size_t idx;
+    if (body_table_find(table, table->removals[i], &idx)) {
+      body_remove(table->bodies[idx]);
+      body_table_erase(table, idx, grid);
+    }
+  }
+  table->num_removals = 0;
+}
+
+// returns the table indices of every body with the given role. use
+// body_table_remove to remove bodies while walking the set, since it only
+// queues them
+role_set_t *body_table_role(body_table_t *table, role_t role) {
+  return &table->role_sets[role_slot(role)];
+}
+
+// bit for a role in a role mask
+uint32_t role_bit(role_t role) {
+  assert(NUM_ROLES <= 32);
+  return (uint32_t)1 << role_slot(role);
+}
+
+// pulls every body with one of the field's roles with the same acceleration,
+// like gravity does
+typedef struct force_field {
+  vector_t acceleration;
+  uint32_t role_mask; // role_bit of each role the field acts on
+} force_field_t;
+
+// the fields registered on the scene. the scene owns this and frees it
+typedef struct force_fields {
+  body_table_t *table;
+  size_t size;
+  size_t capacity;
+  force_field_t *fields;
+} force_fields_t;
+
+force_fields_t *force_fields_init(body_table_t *table) {
+  force_fields_t *fields = calloc(1, sizeof(force_fields_t));
+  assert(fields != NULL);
+  fields->table = table;
+  return fields;
+}
+
+void force_fields_free(void *fields) {
+  free(((force_fields_t *)fields)->fields);
+  free(fields);
+}
+
+void force_fields_add(force_fields_t *fields, vector_t acceleration,
+                      uint32_t role_mask) {
+  if (fields->size == fields->capacity) {
+    fields->capacity = fields->capacity == 0 ? 2 : fields->capacity * 2;
+    fields->fields =
+        realloc(fields->fields, fields->capacity * sizeof(force_field_t));
+    assert(fields->fields != NULL);
+  }
+  fields->fields[fields->size] = (force_field_t){
+      .acceleration = acceleration, .role_mask = role_mask};
+  fields->size++;
+}
+
+// force creator for the fields. it runs inside scene_tick, so the forces go
+// through the same integration step as every other force. the role sets pick
+// out the bodies, so no other body is looked at
+void apply_force_fields(void *aux) {
+  force_fields_t *fields = aux;
+  body_table_t *table = fields->table;
+  for (size_t i = 0; i < fields->size; i++) {
+    force_field_t *field = &fields->fields[i];
+    for (size_t slot = 0; slot < NUM_ROLES; slot++) {
+      if ((field->role_mask & ((uint32_t)1 << slot)) == 0) {
+        continue;
+      }
+      role_set_t *set = &table->role_sets[slot];
+      for (size_t j = 0; j < set->size; j++) {
+        size_t idx = set->indices[j];
+        if (table->masses[idx] != INFINITY && table->asleep[idx] == false) {
+          body_add_force(table->bodies[idx],
+                         vec_multiply(table->masses[idx], field->acceleration));
+        }
+      }
+    }
+  }
+}
+
+shape_view_t body_table_shape(body_table_t *table, size_t i) {
+  assert(i < table->size);
+  return (shape_view_t){.vertices = table->vertices[i],
+                        .size = table->num_vertices[i],
+                        .points = table->shapes[i]};
+}
+
+// drops the bodies that the last scene_tick freed on its own and refreshes
+// the fields that the tick may have changed. grid squares whose block was
+// freed are emptied, and the rest get the block's new health. scene_tick only
+// ever removes bodies and keeps the rest in order, so the scene's list is a
+// subsequence of order and only pointer comparisons are needed to find the
+// dropped entries. must be called right after every scene_tick, before any
+// new body can reuse a freed address
+void body_table_sync(body_table_t *table, scene_t *scene, grid_cell_t *grid) {
+  list_t *all_bodies = scene_get_all_bodies(scene);
+  size_t num_bodies = list_size(all_bodies);
+  size_t kept = 0;
+  for (size_t i = 0; i < table->order_size; i++) {
+    scene_entry_t entry = table->order[i];
+    if (kept < num_bodies && entry.body == list_get(all_bodies, kept)) {
+      table->order[kept] = entry;
+      kept++;
+      continue;
+    }
+    // bodies removed through the queue are already out of the table
+    size_t idx;
+    if (body_table_find(table, entry.handle, &idx)) {
+      body_table_erase(table, idx, grid);
+    }
+  }
+  assert(kept == num_bodies);
+  table->order_size = kept;
+
+  for (size_t i = 0; i < table->size; i++) {
+    body_t *body = table->bodies[i];
+    table->healths[i] = body_get_health(body);
+    if (table->masses[i] != INFINITY) {
+      table->last_centroids[i] = table->centroids[i];
+      table->centroids[i] = body_get_centroid(body);
+      table->velocities[i] = body_get_velocity(body);
+    }
+    if (table->grid_cells[i] != NO_GRID_CELL) {
+      grid[table->grid_cells[i]].health = table->healths[i];
+    }
+  }
+}
+
+// puts dynamic bodies that have stayed slow for SLEEP_DELAY to sleep, and
+// wakes sleeping ones that something has pushed since
+void body_table_update_sleep(body_table_t *table, double dt) {
+  for (size_t slot = 0; slot < NUM_ROLES; slot++) {
+    if (role_motion(ROLES[slot]) != MOTION_DYNAMIC) {
+      continue;
+    }
+    role_set_t *set = &table->role_sets[slot];
+    for (size_t i = 0; i < set->size; i++) {
+      size_t idx = set->indices[i];
+      vector_t velocity = table->velocities[idx];
+      if (vec_dot(velocity, velocity) >= SLEEP_SPEED * SLEEP_SPEED) {
+        table->rest_times[idx] = 0.0;
+        table->asleep[idx] = false;
+        continue;
+      }
+      table->rest_times[idx] += dt;
+      if (table->asleep[idx] == false &&
+          table->rest_times[idx] >= SLEEP_DELAY) {
+        table->asleep[idx] = true;
+        table->velocities[idx] = VEC_ZERO;
+        body_set_velocity(table->bodies[idx], VEC_ZERO);
+      }
+    }
+  }
+}
+
+// a polygon drawn over the scene. ui polygons are not bodies, so the scene
+// never ticks them
+typedef struct ui_polygon {
+  vector_t *vertices;
+  size_t num_vertices;
+  list_t *points; // view over vertices, for sdl_draw_polygon
+  rgb_color_t color;
+} ui_polygon_t;
+
+// retained ui widgets. each widget is a list of ui_polygon_t that is built
+// once and only moved when what it shows changes
+typedef struct ui {
+  list_t *pause_button;
+  list_t *play_button;
+  list_t *selection_circle;
+  size_t circle_selection; // block the selection circle is drawn around
+  list_t *hover_square;
+  size_t hover_cell;   // grid square under the hover square, or NO_GRID_CELL
+  size_t hover_placed; // grid square its vertices sit over, even when hidden
+  list_t *profile_bars; // one bar per phase and a frame budget marker
+} ui_t;
+
+// the parts of a frame that the profiler times. gravity is a force creator,
+// so the gravity pass is timed as part of PHASE_SCENE_TICK. PHASE_FRAME spans
+// a whole frame and carries its body and pair counts
+typedef enum {
+  PHASE_SCENE_TICK,
+  PHASE_SYNC,
+  PHASE_COLLISION,
+  PHASE_SPAWN,
+  PHASE_OUT_OF_BOUNDS,
+  PHASE_DRAW,
+  PHASE_UI,
+  PHASE_TEXT,
+  PHASE_SHOW,
+  PHASE_FRAME,
+  NUM_PHASES
+} phase_t;
+
+const char *PHASE_NAMES[NUM_PHASES] = {
+    "scene_tick",
+    "body_table_sync",
+    "broad_phase",
+    "spawn_weapon",
+    "remove_weapons_out_of_bounds",
+    "draw_bodies",
+    "draw_ui",
+    "draw_text",
+    "sdl_show",
+    "frame",
+};
+const rgb_color_t PHASE_COLORS[NUM_PHASES] = {
+    {.r = 0.9, .g = 0.1, .b = 0.1}, {.r = 0.9, .g = 0.5, .b = 0.1},
+    {.r = 0.9, .g = 0.9, .b = 0.1}, {.r = 0.5, .g = 0.9, .b = 0.1},
+    {.r = 0.1, .g = 0.9, .b = 0.5}, {.r = 0.1, .g = 0.5, .b = 0.9},
+    {.r = 0.1, .g = 0.1, .b = 0.9}, {.r = 0.5, .g = 0.1, .b = 0.9},
+    {.r = 0.9, .g = 0.1, .b = 0.9}, {.r = 0.0, .g = 0.0, .b = 0.0}};
+
+// one timed phase
+typedef struct profile_event {
+  uint32_t phase;
+  uint32_t bodies; // bodies in the scene, for PHASE_FRAME
+  uint32_t pairs;  // contact pairs handed out in the frame, for PHASE_FRAME
+  uint64_t frame;
+  double start; // seconds since the profiler was made
+  double duration;
+} profile_event_t;
+
+// keeps the last PROFILE_CAPACITY events in a ring. any thread can record
+// without a lock: it claims a slot by bumping head, and stamps the slot with
+// the event's number once the event is written. a reader copies a slot and
+// only keeps the copy if the stamp was the same before and after
+typedef struct profiler {
+  profile_event_t *events;
+  _Atomic uint64_t *stamps; // event number + 1 in each slot, 0 mid write
+  size_t capacity;
+  _Atomic uint64_t head; // events recorded so far
+  double origin;
+  // the rest is only touched by the thread that runs the frames
+  uint64_t frame;
+  double frame_start;
+  double current[NUM_PHASES]; // time spent so far in each phase this frame
+  double last[NUM_PHASES];    // the same for the last finished frame
+  size_t last_pairs;
+} profiler_t;
+
+// a key press or click that changes the game, and the tick it came in before
+typedef struct input_event {
+  uint64_t tick;
+  int32_t key;
+  uint32_t button;
+  vector_t loc;
+} input_event_t;
+
+// the seed and inputs of a session, which are all it takes to play it again
+typedef struct recording {
+  uint64_t seed;
+  size_t size;
+  size_t capacity;
+  input_event_t *events;
+} recording_t;
+
+void recording_add(recording_t *recording, input_event_t event) {
+  if (recording->size == recording->capacity) {
+    recording->capacity =
+        recording->capacity == 0 ? 16 : recording->capacity * 2;
+    recording->events = realloc(recording->events,
+                                recording->capacity * sizeof(input_event_t));
+    assert(recording->events != NULL);
+  }
+  recording->events[recording->size] = event;
+  recording->size++;
+}
+
+double wall_time() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + (now.tv_nsec * 1e-9);
+}
+
+profiler_t *profiler_init(size_t capacity) {
+  assert(capacity > 0 && (capacity & (capacity - 1)) == 0);
+  profiler_t *profiler = malloc(sizeof(profiler_t));
+  assert(profiler != NULL);
+  profiler->events = malloc(capacity * sizeof(profile_event_t));
+  profiler->stamps = calloc(capacity, sizeof(_Atomic uint64_t));
+  assert(profiler->events != NULL && profiler->stamps != NULL);
+  profiler->capacity = capacity;
+  atomic_init(&profiler->head, 0);
+  profiler->origin = wall_time();
+  profiler->frame = 0;
+  profiler->frame_start = profiler->origin;
+  for (size_t i = 0; i < NUM_PHASES; i++) {
+    profiler->current[i] = 0.0;
+    profiler->last[i] = 0.0;
+  }
+  profiler->last_pairs = 0;
+  return profiler;
+}
+
+void profiler_free(profiler_t *profiler) {
+  if (profiler == NULL) {
+    return;
+  }
+  free(profiler->events);
+  free((void *)profiler->stamps);
+  free(profiler);
+}
+
+void profiler_record(profiler_t *profiler, profile_event_t event) {
+  uint64_t number =
+      atomic_fetch_add_explicit(&profiler->head, 1, memory_order_relaxed);
+  size_t slot = number & (profiler->capacity - 1);
+  atomic_store_explicit(&profiler->stamps[slot], 0, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  profiler->events[slot] = event;
+  atomic_store_explicit(&profiler->stamps[slot], number + 1,
+                        memory_order_release);
+}
+
+// copies out the event with the given number. returns false if it has been
+// overwritten or is still being written
+bool profiler_read(profiler_t *profiler, uint64_t number,
+                   profile_event_t *event) {
+  size_t slot = number & (profiler->capacity - 1);
+  if (atomic_load_explicit(&profiler->stamps[slot], memory_order_acquire) !=
+      number + 1) {
+    return false;
+  }
+  *event = profiler->events[slot];
+  atomic_thread_fence(memory_order_acquire);
+  return atomic_load_explicit(&profiler->stamps[slot],
+                              memory_order_relaxed) == number + 1;
+}
+
+// profile_begin and profile_end go around a phase. both do nothing when
+// profiling is off
+double profile_begin(profiler_t *profiler) {
+  return profiler != NULL ? wall_time() : 0.0;
+}
+
+void profile_end(profiler_t *profiler, phase_t phase, double start) {
+  if (profiler == NULL) {
+    return;
+  }
+  double duration = wall_time() - start;
+  profiler->current[phase] += duration;
+  profiler_record(profiler, (profile_event_t){.phase = phase,
+                                              .frame = profiler->frame,
+                                              .start = start - profiler->origin,
+                                              .duration = duration});
+}
+
+// closes the current frame with the number of bodies in the scene and the
+// running count of contact pairs, which restarts at zero every wave
+void profile_frame(profiler_t *profiler, size_t bodies, size_t pairs) {
+  if (profiler == NULL) {
+    return;
+  }
+  double now = wall_time();
+  size_t frame_pairs =
+      pairs >= profiler->last_pairs ? pairs - profiler->last_pairs : pairs;
+  profiler_record(profiler,
+                  (profile_event_t){.phase = PHASE_FRAME,
+                                    .bodies = bodies,
+                                    .pairs = frame_pairs,
+                                    .frame = profiler->frame,
+                                    .start = profiler->frame_start -
+                                             profiler->origin,
+                                    .duration = now - profiler->frame_start});
+  profiler->current[PHASE_FRAME] = now - profiler->frame_start;
+  for (size_t i = 0; i < NUM_PHASES; i++) {
+    profiler->last[i] = profiler->current[i];
+    profiler->current[i] = 0.0;
+  }
+  profiler->last_pairs = pairs;
+  profiler->frame++;
+  profiler->frame_start = now;
+}
+
+// writes the events still in the ring as Chrome trace JSON, which
+// chrome://tracing and Perfetto can open. every phase becomes a complete
+// event, and every frame also becomes a counter event with its counts
+bool profiler_save_trace(profiler_t *profiler, const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    return false;
+  }
+  uint64_t head = atomic_load_explicit(&profiler->head, memory_order_acquire);
+  uint64_t first = head > profiler->capacity ? head - profiler->capacity : 0;
+  const char *separator = "";
+  fprintf(file, "{\"traceEvents\":[");
+  for (uint64_t number = first; number < head; number++) {
+    profile_event_t event;
+    if (profiler_read(profiler, number, &event) == false) {
+      continue;
+    }
+    double start = event.start * 1e6;
+    fprintf(file,
+            "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":0,"
+            "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+            separator, PHASE_NAMES[event.phase], start, event.duration * 1e6,
+            (unsigned long long)event.frame);
+    separator = ",";
+    if (event.phase == PHASE_FRAME) {
+      fprintf(file,
+              ",\n{\"name\":\"counts\",\"ph\":\"C\",\"pid\":0,\"tid\":0,"
+              "\"ts\":%.3f,\"args\":{\"bodies\":%u,\"pairs\":%u}}",
+              start, event.bodies, event.pairs);
+    }
+  }
+  fprintf(file, "\n]}\n");
+  return fclose(file) == 0;
+}
+
+// a weapon waiting to be launched. its body is only built when it launches
+typedef struct weapon_desc {
+  uint32_t sides;    // sides of the shape prototype the weapon is placed from
+  uint32_t reserved; // fills what would be padding, so every byte is set
+  double mass;
+  double launch_angle; // radians
+  double rotation;     // radians the prototype is turned by
+} weapon_desc_t;
+
+// the weapons left in a wave, in launch order, as a ring of descriptors
+typedef struct weapon_queue {
+  weapon_desc_t *descs;
+  size_t capacity;
+  size_t head; // slot of the next weapon to launch
+  size_t size;
+} weapon_queue_t;
+
+weapon_queue_t *weapon_queue_init(size_t capacity) {
+  assert(capacity > 0);
+  weapon_queue_t *queue = malloc(sizeof(weapon_queue_t));
+  assert(queue != NULL);
+  queue->descs = malloc(capacity * sizeof(weapon_desc_t));
+  assert(queue->descs != NULL);
+  queue->capacity = capacity;
+  queue->head = 0;
+  queue->size = 0;
+  return queue;
+}
+
+void weapon_queue_free(weapon_queue_t *queue) {
+  free(queue->descs);
+  free(queue);
+}
+
+// returns the weapon index places from the front
+weapon_desc_t weapon_queue_get(weapon_queue_t *queue, size_t index) {
+  assert(index < queue->size);
+  return queue->descs[(queue->head + index) % queue->capacity];
+}
+
+void weapon_queue_push(weapon_queue_t *queue, weapon_desc_t desc) {
+  if (queue->size == queue->capacity) {
+    // unwrap into a bigger block so the front is back at slot 0
+    weapon_desc_t *descs = malloc(2 * queue->capacity * sizeof(weapon_desc_t));
+    assert(descs != NULL);
+    for (size_t i = 0; i < queue->size; i++) {
+      descs[i] = weapon_queue_get(queue, i);
+    }
+    free(queue->descs);
+    queue->descs = descs;
+    queue->capacity *= 2;
+    queue->head = 0;
+  }
+  queue->descs[(queue->head + queue->size) % queue->capacity] = desc;
+  queue->size++;
+}
+
+weapon_desc_t weapon_queue_pop(weapon_queue_t *queue) {
+  weapon_desc_t desc = weapon_queue_get(queue, 0);
+  queue->head = (queue->head + 1) % queue->capacity;
+  queue->size--;
+  return desc;
+}
+
+void weapon_queue_clear(weapon_queue_t *queue) {
+  queue->head = 0;
+  queue->size = 0;
+}
+
+// a saved game in the format described at snapshot_capture
+typedef struct snapshot {
+  void *data;
+  size_t size;
+} snapshot_t;
+
+typedef struct state {
+  scene_t *scene;
+  body_table_t *bodies;  // the bodies in the scene, in the scene's order
+  body_table_t *scenery; // static bodies, which are kept out of the scene
+  game_state_t game_state;
+  double last_weapon_time;
+  double total_time_elapsed;
+  size_t block_selected;
+  text_t *text;
+  weapon_queue_t *weapon_queue;
+  size_t level;
+  size_t credits;
+  double egg_health;
+  bool game_over;
+  bool is_paused;
+  text_t *game_over_text;
+  list_t *costs;
+  grid_cell_t *grid; // NUM_GRID_ROWS * NUM_GRID_COLS squares
+  size_t contact_pairs; // pairs the broad phase has handed out this wave
+  ui_t *ui;
+  SDL_Texture *building_layer; // static bodies with the grid lines
+  SDL_Texture *shooting_layer; // static bodies without the grid lines
+  int layer_width;
+  int layer_height;
+  struct draw_batch *batch; // NULL when polygons are drawn one by one
+  struct hud *hud;          // NULL when text goes through sdl_render_text
+  body_memory_t *memory;
+  list_t *prototypes; // shape_prototype_t for each weapon's number of sides
+  force_fields_t *force_fields; // owned by the scene
+  job_pool_t *jobs;
+  struct candidate_list *candidates; // broad phase output, one per weapon
+  size_t candidates_capacity;
+  rng_t rng;
+  snapshot_t start; // the game as game_init left it, restored by restart
+  uint64_t ticks;   // game_ticks run so far
+  double tick_time; // time the display is ahead of the last tick
+  recording_t recording;
+  profiler_t *profiler; // NULL when frames aren't profiled
+  alloc_stats_t *alloc_stats;
+} state_t;
+
+// prints what is still allocated, category by category and then role by
+// role, and returns how many allocations that is
+size_t alloc_stats_print(alloc_stats_t *stats, FILE *file) {
+  size_t live = 0;
+  for (size_t i = 0; i < NUM_ALLOC_CATEGORIES; i++) {
+    alloc_count_t *count = &stats->categories[i];
+    fprintf(file, "%-10s %8zu live %10zu bytes %10zu total\n",
+            ALLOC_CATEGORY_NAMES[i], count->live, count->bytes, count->total);
+    live += count->live;
+  }
+  for (size_t i = 0; i < NUM_ROLES; i++) {
+    alloc_count_t *count = &stats->roles[i];
+    if (count->total > 0) {
+      fprintf(file, "role %-5zu %8zu live %10zu bytes %10zu total\n", i,
+              count->live, count->bytes, count->total);
+    }
+  }
+  return live;
+}
+
+// prints the live count and bytes of every category as a row of csv, after
+// the given level
+void alloc_stats_print_csv(alloc_stats_t *stats, size_t level, FILE *file) {
+  fprintf(file, "%zu", level);
+  for (size_t i = 0; i < NUM_ALLOC_CATEGORIES; i++) {
+    fprintf(file, ",%zu,%zu", stats->categories[i].live,
+            stats->categories[i].bytes);
+  }
+  fprintf(file, "\n");
+}
+
+void alloc_stats_print_csv_header(FILE *file) {
+  fprintf(file, "level");
+  for (size_t i = 0; i < NUM_ALLOC_CATEGORIES; i++) {
+    fprintf(file, ",%s_live,%s_bytes", ALLOC_CATEGORY_NAMES[i],
+            ALLOC_CATEGORY_NAMES[i]);
+  }
+  fprintf(file, "\n");
+}
+
+// reports anything the game allocated and never freed
+void alloc_stats_report_leaks(alloc_stats_t *stats) {
+  size_t live = 0;
+  for (size_t i = 0; i < NUM_ALLOC_CATEGORIES; i++) {
+    live += stats->categories[i].live;
+  }
+  if (live > 0) {
+    fprintf(stderr, "%zu allocations leaked:\n", live);
+    alloc_stats_print(stats, stderr);
+  }
+}
+
+// seeds the game's random numbers and notes the seed in the recording
+void game_seed(state_t *state, uint64_t seed) {
+  rng_seed(&state->rng, seed);
+  state->recording.seed = seed;
+}
+
+// adds a body to the scene and to the game's body table. every body has to go
+// through here so the table stays in the scene's order. static bodies go to
+// the scenery table instead, so scene_tick never walks them
+void game_add_body(state_t *state, body_t *body) {
+  if (role_motion(*(role_t *)body_get_info(body)) == MOTION_STATIC) {
+    body_table_add(state->scenery, body, NO_GRID_CELL);
+    return;
+  }
+  scene_add_body(state->scene, body);
+  body_table_add(state->bodies, body, NO_GRID_CELL);
+}
+
+// adds a block that sits on the given grid square and records it in the
+// square, so the square is emptied again once the block is destroyed
+void game_add_block(state_t *state, body_t *block, size_t cell) {
+  scene_add_body(state->scene, block);
+  body_handle_t handle = body_table_add(state->bodies, block, cell);
+  state->grid[cell] = (grid_cell_t){.occupied = true,
+                                    .block = handle,
+                                    .material = *(role_t *)body_get_info(block),
+                                    .health = body_get_health(block)};
+}
+
+// allocates a body's info with room for its vertices right behind it. blocks
+// come from the block pool, scenery from its own arena, weapons from the
+// wave's arena and everything else from the level's arena
+body_info_t *body_info_alloc(body_memory_t *memory, role_t role,
+                             size_t num_vertices) {
+  body_info_t *body_info;
+  arena_t *arena = NULL;
+  pool_t *pool = NULL;
+  if (is_block_role(role)) {
+    assert(num_vertices == BLOCK_VERTICES);
+    pool = memory->blocks;
+    body_info = pool_alloc(pool);
+  } else {
+    if (role_motion(role) == MOTION_STATIC) {
+      arena = memory->scenery;
+    } else if (role == WEAPON) {
+      arena = memory->wave->current;
+    } else {
+      arena = memory->level->current;
+    }
+    body_info = arena_alloc(arena, sizeof(body_info_t) +
+                                       (num_vertices * sizeof(vector_t)));
+    arena->live++;
+  }
+  body_info->role = role;
+  body_info->vertices = (vector_t *)(body_info + 1);
+  body_info->num_vertices = num_vertices;
+  body_info->shape = NULL;
+  body_info->handle = NO_BODY;
+  body_info->contacts = NULL;
+  body_info->num_contacts = 0;
+  body_info->contacts_capacity = 0;
+  body_info->arena = arena;
+  body_info->pool = pool;
+  body_info->prototype = NULL;
+  body_info->scale = 1.0;
+  body_info->stats = memory->stats;
+  alloc_stats_add_info(memory->stats, body_info);
+  return body_info;
+}
+
+// wraps the info's vertices in a shape list and builds a body from them. the
+// vertices are given back along with the info when the body is freed
+body_t *create_polygon_body(body_info_t *body_info, double mass,
+                            rgb_color_t color) {
+  list_t *shape = list_init(body_info->num_vertices, NULL);
+  for (size_t i = 0; i < body_info->num_vertices; i++) {
+    list_add(shape, &body_info->vertices[i]);
+  }
+  body_info->shape = shape;
+  alloc_stats_add(body_info->stats, ALLOC_BODIES, 0);
+  alloc_stats_add(body_info->stats, ALLOC_LISTS,
+                  body_info->num_vertices * sizeof(vector_t *));
+  return body_init_with_info(shape, mass, color, body_info, body_info_free);
+}
+
+// fills points with sides points evenly spaced around an ellipse
+void ellipse_fill(vector_t *points, size_t sides, double x_radius,
+                  double y_radius, vector_t center) {
+  double angle_inc = (TWO_PI) / sides;
+  for (size_t i = 0; i < sides; i++) {
+    points[i].x = (x_radius * cos(angle_inc * i)) + center.x;
+    points[i].y = (y_radius * sin(angle_inc * i)) + center.y;
+  }
+}
+
+// returns a block of points evenly spaced around an ellipse
+vector_t *ellipse_points(size_t sides, double x_radius, double y_radius,
+                         vector_t center) {
+  vector_t *points = malloc(sides * sizeof(vector_t));
+  assert(points != NULL);
+  ellipse_fill(points, sides, x_radius, y_radius, center);
+  return points;
+}
+
 // x is the x coordinate of the top left corner. // y is the y coordinate of the
 // top left corner
-body_t *create_rectangle_body(double x, double y, double width, double height,
-                              double mass, rgb_color_t color, size_t info,
-                              free_func_t info_freer) {
-  list_t *shape = list_init(4, free);
-  vector_t *top_left = malloc(sizeof(vector_t));
-  top_left->x = x;
-  top_left->y = y;
-  vector_t *top_right = malloc(sizeof(vector_t));
-  top_right->x = x + width;
-  top_right->y = y;
-  vector_t *bottom_right = malloc(sizeof(vector_t));
-  bottom_right->x = x + width;
-  bottom_right->y = y - height;
-  vector_t *bottom_left = malloc(sizeof(vector_t));
-  bottom_left->x = x;
-  bottom_left->y = y - height;
-  list_add(shape, top_left);
-  list_add(shape, top_right);
-  list_add(shape, bottom_right);
-  list_add(shape, bottom_left);
-  role_t *body_info = malloc(sizeof(role_t));
-  *body_info = info;
-  body_t *body = body_init_with_info(shape, mass, color, body_info, info_freer);
-  return body;
+void rectangle_fill(vector_t *points, double x, double y, double width,
+                    double height) {
+  points[0] = (vector_t){.x = x, .y = y};
+  points[1] = (vector_t){.x = x + width, .y = y};
+  points[2] = (vector_t){.x = x + width, .y = y - height};
+  points[3] = (vector_t){.x = x, .y = y - height};
 }
 
-void create_background(scene_t *scene) {
-  body_t *sky = create_rectangle_body(0, WINDOW.y, WINDOW.x, WINDOW.y, INFINITY,
-                                      SKY_COLOR, BACKGROUND, free);
-  scene_add_body(scene, sky);
+vector_t *rectangle_points(double x, double y, double width, double height) {
+  vector_t *points = malloc(4 * sizeof(vector_t));
+  assert(points != NULL);
+  rectangle_fill(points, x, y, width, height);
+  return points;
 }
 
-void create_island(scene_t *scene) {
+// axis-aligned bounding box
+typedef struct aabb {
+  vector_t min;
+  vector_t max;
+} aabb_t;
+
+// writes each point turned by rotation and moved by offset into out, and
+// returns the bounds of what was written. rotation holds the cosine and sine
+// of the angle, both times any scale to apply
+aabb_t transform_points_scalar(const vector_t *points, size_t num_points,
+                               vector_t rotation, vector_t offset,
+                               vector_t *out) {
+  aabb_t bounds = {.min = {.x = INFINITY, .y = INFINITY},
+                   .max = {.x = -INFINITY, .y = -INFINITY}};
+  for (size_t i = 0; i < num_points; i++) {
+    double x = (rotation.x * points[i].x) - (rotation.y * points[i].y);
+    double y = (rotation.y * points[i].x) + (rotation.x * points[i].y);
+    out[i] = (vector_t){.x = x + offset.x, .y = y + offset.y};
+    bounds.min.x = out[i].x < bounds.min.x ? out[i].x : bounds.min.x;
+    bounds.min.y = out[i].y < bounds.min.y ? out[i].y : bounds.min.y;
+    bounds.max.x = out[i].x > bounds.max.x ? out[i].x : bounds.max.x;
+    bounds.max.y = out[i].y > bounds.max.y ? out[i].y : bounds.max.y;
+  }
+  return bounds;
+}
+
+aabb_t points_bounds_scalar(const vector_t *points, size_t num_points) {
+  aabb_t bounds = {.min = points[0], .max = points[0]};
+  for (size_t i = 1; i < num_points; i++) {
+    bounds.min.x = points[i].x < bounds.min.x ? points[i].x : bounds.min.x;
+    bounds.min.y = points[i].y < bounds.min.y ? points[i].y : bounds.min.y;
+    bounds.max.x = points[i].x > bounds.max.x ? points[i].x : bounds.max.x;
+    bounds.max.y = points[i].y > bounds.max.y ? points[i].y : bounds.max.y;
+  }
+  return bounds;
+}
+
+#ifdef __SSE2__
+// a vector_t fills one sse2 register, so each point is a single multiply-add
+// and the bounds are two packed min/max
+_Static_assert(sizeof(vector_t) == 2 * sizeof(double),
+               "vector_t has to be two packed doubles");
+
+aabb_t transform_points_sse2(const vector_t *points, size_t num_points,
+                             vector_t rotation, vector_t offset,
+                             vector_t *out) {
+  __m128d cos_angle = _mm_set1_pd(rotation.x);
+  __m128d sin_angle = _mm_set_pd(rotation.y, -rotation.y);
+  __m128d shift = _mm_loadu_pd(&offset.x);
+  __m128d min = _mm_set1_pd(INFINITY);
+  __m128d max = _mm_set1_pd(-INFINITY);
+  for (size_t i = 0; i < num_points; i++) {
+    __m128d point = _mm_loadu_pd(&points[i].x);
+    __m128d swapped = _mm_shuffle_pd(point, point, 1);
+    __m128d moved = _mm_add_pd(_mm_add_pd(_mm_mul_pd(cos_angle, point),
+                                          _mm_mul_pd(sin_angle, swapped)),
+                               shift);
+    _mm_storeu_pd(&out[i].x, moved);
+    min = _mm_min_pd(min, moved);
+    max = _mm_max_pd(max, moved);
+  }
+  aabb_t bounds;
+  _mm_storeu_pd(&bounds.min.x, min);
+  _mm_storeu_pd(&bounds.max.x, max);
+  return bounds;
+}
+
+aabb_t points_bounds_sse2(const vector_t *points, size_t num_points) {
+  __m128d min = _mm_loadu_pd(&points[0].x);
+  __m128d max = min;
+  for (size_t i = 1; i < num_points; i++) {
+    __m128d point = _mm_loadu_pd(&points[i].x);
+    min = _mm_min_pd(min, point);
+    max = _mm_max_pd(max, point);
+  }
+  aabb_t bounds;
+  _mm_storeu_pd(&bounds.min.x, min);
+  _mm_storeu_pd(&bounds.max.x, max);
+  return bounds;
+}
+#endif
+
+aabb_t transform_points(const vector_t *points, size_t num_points,
+                        vector_t rotation, vector_t offset, vector_t *out) {
+#ifdef __SSE2__
+  return transform_points_sse2(points, num_points, rotation, offset, out);
+#else
+  return transform_points_scalar(points, num_points, rotation, offset, out);
+#endif
+}
+
+aabb_t points_bounds(const vector_t *points, size_t num_points) {
+  assert(num_points > 0);
+#ifdef __SSE2__
+  return points_bounds_sse2(points, num_points);
+#else
+  return points_bounds_scalar(points, num_points);
+#endif
+}
+
+// a regular polygon with a circumradius of 1 centered on the origin. weapons
+// are placed copies of one, so the trig for their vertices is done once per
+// number of sides instead of once per weapon
+typedef struct shape_prototype {
+  size_t sides;
+  vector_t *points;
+  double bounding_radius; // distance from the center to the farthest point
+} shape_prototype_t;
+
+shape_prototype_t *shape_prototype_init(size_t sides) {
+  assert(sides >= 3);
+  shape_prototype_t *prototype = malloc(sizeof(shape_prototype_t));
+  assert(prototype != NULL);
+  prototype->sides = sides;
+  prototype->points = ellipse_points(sides, 1, 1, VEC_ZERO);
+  prototype->bounding_radius = 0;
+  for (size_t i = 0; i < sides; i++) {
+    double dist = sqrt(vec_dot(prototype->points[i], prototype->points[i]));
+    prototype->bounding_radius = fmax(prototype->bounding_radius, dist);
+  }
+  return prototype;
+}
+
+void shape_prototype_free(void *prototype) {
+  free(((shape_prototype_t *)prototype)->points);
+  free(prototype);
+}
+
+// returns the prototype with the given number of sides, building it the
+// first time it is asked for
+const shape_prototype_t *shape_prototype_get(list_t *prototypes,
+                                             size_t sides) {
+  for (size_t i = 0; i < list_size(prototypes); i++) {
+    shape_prototype_t *prototype = list_get(prototypes, i);
+    if (prototype->sides == sides) {
+      return prototype;
+    }
+  }
+  shape_prototype_t *prototype = shape_prototype_init(sides);
+  list_add(prototypes, prototype);
+  return prototype;
+}
+
+// writes the prototype's points scaled by radius, rotated by angle and moved
+// to center into vertices, and returns their bounds
+aabb_t shape_prototype_place(const shape_prototype_t *prototype, double radius,
+                             double angle, vector_t center,
+                             vector_t *vertices) {
+  vector_t rotation =
+      (vector_t){.x = radius * cos(angle), .y = radius * sin(angle)};
+  return transform_points(prototype->points, prototype->sides, rotation,
+                          center, vertices);
+}
+
+body_t *create_rectangle_body(state_t *state, double x, double y,
+                              double width, double height, double mass,
+                              rgb_color_t color, role_t role) {
+  body_info_t *body_info = body_info_alloc(state->memory, role, 4);
+  rectangle_fill(body_info->vertices, x, y, width, height);
+  return create_polygon_body(body_info, mass, color);
+}
+
+void create_background(state_t *state) {
+  body_t *sky = create_rectangle_body(state, 0, WINDOW.y, WINDOW.x, WINDOW.y,
+                                      INFINITY, SKY_COLOR, BACKGROUND);
+  game_add_body(state, sky);
+}
+
+void create_island(state_t *state) {
   body_t *lava =
-      create_rectangle_body(0, LAVA_LEVEL, ISLAND_LEFT_MARGIN, LAVA_LEVEL,
-                            INFINITY, LAVA_COLOR, LAVA, free);
-  scene_add_body(scene, lava);
+      create_rectangle_body(state, 0, LAVA_LEVEL, ISLAND_LEFT_MARGIN,
+                            LAVA_LEVEL, INFINITY, LAVA_COLOR, LAVA);
+  game_add_body(state, lava);
 
   // create the island's shape
   body_t *island = create_rectangle_body(
-      ISLAND_LEFT_MARGIN, ISLAND_HEIGHT, WINDOW.x - ISLAND_LEFT_MARGIN,
-      ISLAND_HEIGHT, ISLAND_MASS, ISLAND_COLOR, ISLAND, free);
-  scene_add_body(scene, island);
+      state, ISLAND_LEFT_MARGIN, ISLAND_HEIGHT, WINDOW.x - ISLAND_LEFT_MARGIN,
+      ISLAND_HEIGHT, ISLAND_MASS, ISLAND_COLOR, ISLAND);
+  game_add_body(state, island);
 }
 
-void create_menu(scene_t *scene) {
+void create_menu(state_t *state) {
   // create the menu shape
   body_t *menu =
-      create_rectangle_body(WINDOW.x - MENU_WIDTH, WINDOW.y, MENU_WIDTH,
-                            WINDOW.y, INFINITY, MENU_COLOR, MENU, free);
-  scene_add_body(scene, menu);
+      create_rectangle_body(state, WINDOW.x - MENU_WIDTH, WINDOW.y, MENU_WIDTH,
+                            WINDOW.y, INFINITY, MENU_COLOR, MENU);
+  game_add_body(state, menu);
 
   // create border
   body_t *border = create_rectangle_body(
-      WINDOW.x - MENU_WIDTH - (MENU_BORDER_WIDTH / 2), WINDOW.y,
-      MENU_BORDER_WIDTH, WINDOW.y, INFINITY, MENU_BORDER_COLOR, MENU, free);
-  scene_add_body(scene, border);
+      state, WINDOW.x - MENU_WIDTH - (MENU_BORDER_WIDTH / 2), WINDOW.y,
+      MENU_BORDER_WIDTH, WINDOW.y, INFINITY, MENU_BORDER_COLOR, MENU);
+  game_add_body(state, border);
 
   double spawn_x = WINDOW.x - (MENU_WIDTH / 2) - (SELECTION_WIDTH / 2);
   double spawn_y = WINDOW.y - SELECTION_SEPARATION;
   // create block selections
   for (size_t i = 0; i < NUM_OF_SELECTIONS; i++) {
-    body_t *new_section = create_rectangle_body(
-        spawn_x, spawn_y, SELECTION_WIDTH, SELECTION_HEIGHT, INFINITY,
-        SELECTION_BACKGROUND, MENU, NULL);
-    scene_add_body(scene, new_section);
+    body_t *new_section =
+        create_rectangle_body(state, spawn_x, spawn_y, SELECTION_WIDTH,
+                              SELECTION_HEIGHT, INFINITY, SELECTION_BACKGROUND,
+                              MENU);
+    game_add_body(state, new_section);
     spawn_y -= (SELECTION_SEPARATION + SELECTION_HEIGHT);
   }
 
   // create bottom section
   body_t *last_section = create_rectangle_body(
-      spawn_x, spawn_y, SELECTION_WIDTH, (spawn_y - SELECTION_SEPARATION),
-      INFINITY, SELECTION_BACKGROUND, MENU, NULL);
-  scene_add_body(scene, last_section);
+      state, spawn_x, spawn_y, SELECTION_WIDTH,
+      (spawn_y - SELECTION_SEPARATION), INFINITY, SELECTION_BACKGROUND, MENU);
+  game_add_body(state, last_section);
 
   double menu_block_margin = (SELECTION_HEIGHT - MENU_BLOCK_DIM) / 2;
   // add blocks in the sections
   spawn_x = WINDOW.x - (MENU_WIDTH / 2) - (MENU_BLOCK_DIM / 2);
   spawn_y = WINDOW.y - SELECTION_SEPARATION - menu_block_margin;
   body_t *block1 =
-      create_rectangle_body(spawn_x, spawn_y, MENU_BLOCK_DIM, MENU_BLOCK_DIM,
-                            INFINITY, HAY_COLOR, MENU, NULL);
-  scene_add_body(scene, block1);
+      create_rectangle_body(state, spawn_x, spawn_y, MENU_BLOCK_DIM,
+                            MENU_BLOCK_DIM, INFINITY, HAY_COLOR, MENU);
+  game_add_body(state, block1);
   spawn_y -= ((menu_block_margin * 2) + MENU_BLOCK_DIM + SELECTION_SEPARATION);
   body_t *block2 =
-      create_rectangle_body(spawn_x, spawn_y, MENU_BLOCK_DIM, MENU_BLOCK_DIM,
-                            INFINITY, WOOD_COLOR, MENU, NULL);
-  scene_add_body(scene, block2);
+      create_rectangle_body(state, spawn_x, spawn_y, MENU_BLOCK_DIM,
+                            MENU_BLOCK_DIM, INFINITY, WOOD_COLOR, MENU);
+  game_add_body(state, block2);
   spawn_y -= ((menu_block_margin * 2) + MENU_BLOCK_DIM + SELECTION_SEPARATION);
   body_t *block3 =
-      create_rectangle_body(spawn_x, spawn_y, MENU_BLOCK_DIM, MENU_BLOCK_DIM,
-                            INFINITY, STEEL_COLOR, MENU, NULL);
-  scene_add_body(scene, block3);
+      create_rectangle_body(state, spawn_x, spawn_y, MENU_BLOCK_DIM,
+                            MENU_BLOCK_DIM, INFINITY, STEEL_COLOR, MENU);
+  game_add_body(state, block3);
   spawn_y -= ((menu_block_margin * 2) + MENU_BLOCK_DIM + SELECTION_SEPARATION);
   body_t *block4 =
-      create_rectangle_body(spawn_x, spawn_y, MENU_BLOCK_DIM, MENU_BLOCK_DIM,
-                            INFINITY, DIAMOND_COLOR, MENU, NULL);
-  scene_add_body(scene, block4);
+      create_rectangle_body(state, spawn_x, spawn_y, MENU_BLOCK_DIM,
+                            MENU_BLOCK_DIM, INFINITY, DIAMOND_COLOR, MENU);
+  game_add_body(state, block4);
+}
+
+// blocks can't be placed on the squares the egg covers
+void mark_egg_squares(state_t *state, body_t *egg) {
+  body_handle_t handle = ((body_info_t *)body_get_info(egg))->handle;
+  for (size_t row = EGG_BOTTOM_LEFT_GRID_ROW;
+       row < EGG_BOTTOM_LEFT_GRID_ROW + EGG_GRID_HEIGHT; row++) {
+    for (size_t col = EGG_BOTTOM_LEFT_GRID_COL;
+         col < EGG_BOTTOM_LEFT_GRID_COL + EGG_GRID_WIDTH; col++) {
+      state->grid[(row * NUM_GRID_COLS) + col] = (grid_cell_t){
+          .occupied = true, .block = handle, .material = EGG, .health = 0.0};
+    }
+  }
 }
 
-void create_egg(scene_t *scene) {
+void create_egg(state_t *state) {
   assert(EGG_MAJOR_AXIS >= 0);
   assert(EGG_MINOR_AXIS >= 0);
-  list_t *egg_points = list_init(EGG_LINE_SEGMENTS, NULL);
-  double angle_increment = TWO_PI / EGG_LINE_SEGMENTS;
-  for (size_t i = 0; i < EGG_LINE_SEGMENTS; i++) {
-    vector_t *point = malloc(sizeof(vector_t));
-    point->x = EGG_MAJOR_AXIS * cos(angle_increment * i);
-    point->y = EGG_MINOR_AXIS * sin(angle_increment * i);
-    list_add(egg_points, point);
-  }
-  role_t *body_info = malloc(sizeof(role_t));
-  *body_info = EGG;
-  body_t *ret = body_init_with_info(egg_points, 1, EGG_COLOR, body_info, free);
+  body_info_t *egg_info =
+      body_info_alloc(state->memory, EGG, EGG_LINE_SEGMENTS);
+  ellipse_fill(egg_info->vertices, EGG_LINE_SEGMENTS, EGG_MAJOR_AXIS,
+               EGG_MINOR_AXIS, VEC_ZERO);
+  body_t *ret = create_polygon_body(egg_info, 1, EGG_COLOR);
   body_set_health(ret, EGG_HEALTH);
   body_set_centroid(ret, EGG_CENTROID);
-  scene_add_body(scene, ret);
+  game_add_body(state, ret);
+  mark_egg_squares(state, ret);
 }
 
-void create_grid(scene_t *scene) {
+void create_grid(state_t *state) {
   // create horizontal lines
   for (size_t i = 1; i < NUM_GRID_ROWS; i++) {
     body_t *line = create_rectangle_body(
-        GRID_BOTTOM_LEFT.x,
+        state, GRID_BOTTOM_LEFT.x,
         GRID_BOTTOM_LEFT.y + (i * GRID_SQUARE_HEIGHT) +
             (GRID_LINE_THICKNESS / 2),
         NUM_GRID_COLS * GRID_SQUARE_WIDTH, GRID_LINE_THICKNESS, INFINITY,
-        GRID_LINE_COLOR, GRID_LINE, free);
-    scene_add_body(scene, line);
+        GRID_LINE_COLOR, GRID_LINE);
+    game_add_body(state, line);
   }
 
   // create vertical lines
   for (size_t i = 1; i < NUM_GRID_COLS; i++) {
     body_t *line = create_rectangle_body(
-        GRID_BOTTOM_LEFT.x + (i * GRID_SQUARE_WIDTH) -
+        state, GRID_BOTTOM_LEFT.x + (i * GRID_SQUARE_WIDTH) -
             (GRID_LINE_THICKNESS / 2),
         GRID_BOTTOM_LEFT.y + (NUM_GRID_ROWS * GRID_SQUARE_HEIGHT),
         GRID_LINE_THICKNESS, (NUM_GRID_ROWS * GRID_SQUARE_HEIGHT), INFINITY,
-        GRID_LINE_COLOR, GRID_LINE, free);
-    scene_add_body(scene, line);
+        GRID_LINE_COLOR, GRID_LINE);
+    game_add_body(state, line);
   }
 }
 
-typedef struct state {
-  scene_t *scene;
-  game_state_t game_state;
-  double last_weapon_time;
-  double total_time_elapsed;
-  size_t block_selected;
-  text_t *text;
-  list_t *weapon_queue;
-  size_t level;
-  size_t credits;
-  double egg_health;
-  bool game_over;
-  bool is_paused;
-  text_t *game_over_text;
-  list_t *costs;
-  list_t *egg_grid_spots_x;
-  list_t *egg_grid_spots_y;
-} state_t;
+body_t *get_egg(state_t *state) {
+  role_set_t *eggs = body_table_role(state->bodies, EGG);
+  if (eggs->size == 0) {
+    return NULL;
+  }
+  return state->bodies->bodies[eggs->indices[0]];
+}
 
-body_t *get_egg(scene_t *scene) {
-  list_t *all_bodies = scene_get_all_bodies(scene);
-  for (size_t i = 0; i < list_size(all_bodies); i++) {
-    body_t *curr_body = list_get(all_bodies, i);
-    if (*(role_t *)body_get_info(curr_body) == EGG) {
-      return curr_body;
-    }
+ui_polygon_t *ui_polygon_init(vector_t *vertices, size_t num_vertices,
+                              rgb_color_t color) {
+  ui_polygon_t *polygon = malloc(sizeof(ui_polygon_t));
+  assert(polygon != NULL);
+  polygon->vertices = vertices;
+  polygon->num_vertices = num_vertices;
+  polygon->points = list_init(num_vertices, NULL);
+  for (size_t i = 0; i < num_vertices; i++) {
+    list_add(polygon->points, &vertices[i]);
   }
-  return NULL;
+  polygon->color = color;
+  return polygon;
 }
 
-// make it so that this does not get redrawn every single scene tick
-void draw_pause_play(state_t *state) {
-  list_t *all_bodies = scene_get_all_bodies(state->scene);
-  for (size_t i = 0; i < list_size(all_bodies); i++) {
-    body_t *curr_body = list_get(all_bodies, i);
-    if (*(role_t *)body_get_info(curr_body) == PAUSE_PLAY) {
-      body_remove(curr_body);
+void ui_polygon_free(void *polygon) {
+  list_free(((ui_polygon_t *)polygon)->points);
+  free(((ui_polygon_t *)polygon)->vertices);
+  free(polygon);
+}
+
+// moves every polygon of a widget by delta
+void ui_widget_translate(list_t *widget, vector_t delta) {
+  for (size_t i = 0; i < list_size(widget); i++) {
+    ui_polygon_t *polygon = list_get(widget, i);
+    for (size_t j = 0; j < polygon->num_vertices; j++) {
+      polygon->vertices[j] = vec_add(polygon->vertices[j], delta);
     }
   }
+}
+
+// where the selection circle goes for the given block
+vector_t selection_circle_center(size_t block_selected) {
+  double spawn_loc_x = ((WINDOW.x - SELECTION_SEPARATION) +
+                        (WINDOW.x - (MENU_WIDTH / 2) + (MENU_BLOCK_DIM / 2))) /
+                       2;
+  double spawn_loc_y = WINDOW.y - SELECTION_SEPARATION - (SELECTION_HEIGHT / 2);
+  if (block_selected == WOOD) {
+    spawn_loc_y -= (WOOD_INDEX * (SELECTION_HEIGHT + SELECTION_SEPARATION));
+  }
+  if (block_selected == STEEL) {
+    spawn_loc_y -= (STEEL_INDEX * (SELECTION_HEIGHT + SELECTION_SEPARATION));
+  }
+  if (block_selected == DIAMOND) {
+    spawn_loc_y -= (DIAMOND_INDEX * (SELECTION_HEIGHT + SELECTION_SEPARATION));
+  }
+  return (vector_t){.x = spawn_loc_x, .y = spawn_loc_y};
+}
+
+// bottom left corner of the given grid square
+vector_t grid_cell_corner(size_t cell) {
+  return (vector_t){
+      .x = GRID_BOTTOM_LEFT.x + ((cell % NUM_GRID_COLS) * GRID_SQUARE_WIDTH),
+      .y = GRID_BOTTOM_LEFT.y + ((cell / NUM_GRID_COLS) * GRID_SQUARE_HEIGHT)};
+}
+
+// builds every ui widget once
+ui_t *ui_init() {
+  ui_t *ui = malloc(sizeof(ui_t));
+  assert(ui != NULL);
+
+  // pause button: red circle with two lines
+  ui->pause_button = list_init(3, ui_polygon_free);
+  list_add(ui->pause_button,
+           ui_polygon_init(ellipse_points(PAUSE_PLAY_SIDES, PAUSE_PLAY_RADIUS,
+                                          PAUSE_PLAY_RADIUS, PAUSE_PLAY_LOC),
+                           PAUSE_PLAY_SIDES, RED));
+  list_add(ui->pause_button,
+           ui_polygon_init(
+               rectangle_points(
+                   PAUSE_PLAY_LOC.x - PAUSE_LINE_WIDTH - PAUSE_LINE_WIDTH,
+                   PAUSE_PLAY_LOC.y + (PAUSE_LINE_HEIGHT / 2),
+                   PAUSE_LINE_WIDTH, PAUSE_LINE_HEIGHT),
+               4, WHITE));
+  list_add(ui->pause_button,
+           ui_polygon_init(
+               rectangle_points(PAUSE_PLAY_LOC.x + PAUSE_LINE_WIDTH,
+                                PAUSE_PLAY_LOC.y + (PAUSE_LINE_HEIGHT / 2),
+                                PAUSE_LINE_WIDTH, PAUSE_LINE_HEIGHT),
+               4, WHITE));
+
+  // play button: green circle with a triangle
+  ui->play_button = list_init(2, ui_polygon_free);
+  list_add(ui->play_button,
+           ui_polygon_init(ellipse_points(PAUSE_PLAY_SIDES, PAUSE_PLAY_RADIUS,
+                                          PAUSE_PLAY_RADIUS, PAUSE_PLAY_LOC),
+                           PAUSE_PLAY_SIDES, GREEN));
+  list_add(ui->play_button,
+           ui_polygon_init(ellipse_points(TRIANGLE_SIDES, PLAY_TRIANGLE_RADIUS,
+                                          PLAY_TRIANGLE_RADIUS, PAUSE_PLAY_LOC),
+                           TRIANGLE_SIDES, WHITE));
+
+  ui->selection_circle = list_init(1, ui_polygon_free);
+  ui->circle_selection = HAY;
+  list_add(ui->selection_circle,
+           ui_polygon_init(ellipse_points(SELECTION_CIRCLE_SIDES,
+                                          SELECTION_CIRCLE_RADIUS,
+                                          SELECTION_CIRCLE_RADIUS,
+                                          selection_circle_center(HAY)),
+                           SELECTION_CIRCLE_SIDES, BLACK));
+
+  // the hover square starts out hidden over the first grid square
+  ui->hover_square = list_init(1, ui_polygon_free);
+  ui->hover_cell = NO_GRID_CELL;
+  ui->hover_placed = 0;
+  list_add(ui->hover_square,
+           ui_polygon_init(
+               rectangle_points(
+                   GRID_BOTTOM_LEFT.x + (GRID_LINE_THICKNESS / 2),
+                   GRID_BOTTOM_LEFT.y + GRID_SQUARE_HEIGHT -
+                       (GRID_LINE_THICKNESS / 2),
+                   GRID_SQUARE_WIDTH - GRID_LINE_THICKNESS,
+                   GRID_SQUARE_HEIGHT - GRID_LINE_THICKNESS),
+               4, HOVER_SQUARE_COLOR));
+
+  // the profile bars are sized by draw_profile_overlay
+  ui->profile_bars = list_init(NUM_PHASES, ui_polygon_free);
+  for (size_t i = 0; i <= PHASE_SHOW; i++) {
+    list_add(ui->profile_bars,
+             ui_polygon_init(rectangle_points(0, 0, 0, 0), 4, PHASE_COLORS[i]));
+  }
+  list_add(ui->profile_bars,
+           ui_polygon_init(rectangle_points(0, 0, 0, 0), 4, BLACK));
+  return ui;
+}
+
+void ui_free(ui_t *ui) {
+  list_free(ui->pause_button);
+  list_free(ui->play_button);
+  list_free(ui->selection_circle);
+  list_free(ui->hover_square);
+  list_free(ui->profile_bars);
+  free(ui);
+}
+
+// moves the hover square over the given grid square, or hides it if the
+// square is NO_GRID_CELL
+void ui_set_hover_cell(ui_t *ui, size_t cell) {
+  if (cell != NO_GRID_CELL) {
+    ui_widget_translate(ui->hover_square,
+                        vec_subtract(grid_cell_corner(cell),
+                                     grid_cell_corner(ui->hover_placed)));
+    ui->hover_placed = cell;
+  }
+  ui->hover_cell = cell;
+}
+
+#ifndef HEADLESS
+// sdl_wrapper keeps its window and renderer to itself, so find them through
+// the only window it creates
+SDL_Window *get_window() { return SDL_GetWindowFromID(1); }
+
+SDL_Renderer *get_renderer() {
+  SDL_Window *window = get_window();
+  return window == NULL ? NULL : SDL_GetRenderer(window);
+}
+
+// triangles for every polygon drawn in a frame, submitted to the renderer in
+// a single SDL_RenderGeometry call instead of one call per polygon
+typedef struct draw_batch {
+  SDL_Vertex *vertices;
+  size_t num_vertices;
+  size_t vertices_capacity;
+  int *indices;
+  size_t num_indices;
+  size_t indices_capacity;
+  vector_t window_center;
+  double scale; // pixels per scene unit
+} draw_batch_t;
+
+draw_batch_t *draw_batch_init() {
+  draw_batch_t *batch = calloc(1, sizeof(draw_batch_t));
+  assert(batch != NULL);
+  return batch;
+}
+
+void draw_batch_free(draw_batch_t *batch) {
+  free(batch->vertices);
+  free(batch->indices);
+  free(batch);
+}
+
+// starts a new batch, using the same scene to window mapping as sdl_wrapper:
+// the scene is scaled to fit the window, centered, with y pointing up
+void draw_batch_begin(draw_batch_t *batch) {
+  int width, height;
+  SDL_GetWindowSize(get_window(), &width, &height);
+  batch->window_center = (vector_t){.x = width / 2.0, .y = height / 2.0};
+  vector_t max_diff = vec_subtract(WINDOW, CENTER);
+  batch->scale = fmin(batch->window_center.x / max_diff.x,
+                      batch->window_center.y / max_diff.y);
+  batch->num_vertices = 0;
+  batch->num_indices = 0;
+}
+
+// maps a point in the scene to a pixel in the window
+vector_t window_position(draw_batch_t *batch, vector_t scene_pos) {
+  vector_t offset = vec_subtract(scene_pos, CENTER);
+  return (vector_t){.x = batch->window_center.x + (batch->scale * offset.x),
+                    .y = batch->window_center.y - (batch->scale * offset.y)};
+}
+
+// adds a convex polygon to the batch as a triangle fan
+void draw_batch_add(draw_batch_t *batch, shape_view_t shape,
+                    rgb_color_t color) {
+  if (shape.size < 3) {
+    return;
+  }
+  size_t num_vertices = batch->num_vertices + shape.size;
+  if (num_vertices > batch->vertices_capacity) {
+    batch->vertices_capacity = batch->vertices_capacity * 2 > num_vertices
+                                   ? batch->vertices_capacity * 2
+                                   : num_vertices;
+    batch->vertices = realloc(batch->vertices,
+                              batch->vertices_capacity * sizeof(SDL_Vertex));
+    assert(batch->vertices != NULL);
+  }
+  size_t num_indices = batch->num_indices + ((shape.size - 2) * 3);
+  if (num_indices > batch->indices_capacity) {
+    batch->indices_capacity = batch->indices_capacity * 2 > num_indices
+                                  ? batch->indices_capacity * 2
+                                  : num_indices;
+    batch->indices =
+        realloc(batch->indices, batch->indices_capacity * sizeof(int));
+    assert(batch->indices != NULL);
+  }
+
+  SDL_Color sdl_color = {.r = color.r * 255,
+                         .g = color.g * 255,
+                         .b = color.b * 255,
+                         .a = 255};
+  size_t first = batch->num_vertices;
+  for (size_t i = 0; i < shape.size; i++) {
+    vector_t position = window_position(batch, shape.vertices[i]);
+    SDL_Vertex *vertex = &batch->vertices[first + i];
+    vertex->position = (SDL_FPoint){.x = position.x, .y = position.y};
+    vertex->color = sdl_color;
+    vertex->tex_coord = (SDL_FPoint){.x = 0, .y = 0};
+  }
+  for (size_t i = 1; i + 1 < shape.size; i++) {
+    batch->indices[batch->num_indices] = first;
+    batch->indices[batch->num_indices + 1] = first + i;
+    batch->indices[batch->num_indices + 2] = first + i + 1;
+    batch->num_indices += 3;
+  }
+  batch->num_vertices += shape.size;
+}
+
+// draws everything added since the last flush, in the order it was added
+void draw_batch_flush(draw_batch_t *batch, SDL_Renderer *renderer) {
+  if (batch->num_indices > 0) {
+    SDL_RenderGeometry(renderer, NULL, batch->vertices, batch->num_vertices,
+                       batch->indices, batch->num_indices);
+  }
+  batch->num_vertices = 0;
+  batch->num_indices = 0;
+}
+
+// draws a polygon through the frame's batch when there is one
+void draw_polygon(state_t *state, shape_view_t shape, rgb_color_t color) {
+  if (state->batch != NULL) {
+    draw_batch_add(state->batch, shape, color);
+  } else {
+    sdl_draw_polygon(shape.points, color);
+  }
+}
+
+void ui_draw_widget(state_t *state, list_t *widget) {
+  for (size_t i = 0; i < list_size(widget); i++) {
+    ui_polygon_t *polygon = list_get(widget, i);
+    shape_view_t shape = {.vertices = polygon->vertices,
+                          .size = polygon->num_vertices,
+                          .points = polygon->points};
+    draw_polygon(state, shape, polygon->color);
+  }
+}
+
+void draw_pause_play(state_t *state) {
   // draw a pause button
   if (state->is_paused == false) {
-    // make background
-    double angle_inc = (TWO_PI) / PAUSE_PLAY_SIDES;
-    double curr_angle = 0.0;
-    list_t *sides = list_init(PAUSE_PLAY_SIDES, NULL);
-    for (size_t i = 0; i < PAUSE_PLAY_SIDES; i++) {
-      vector_t *new_vec = malloc(sizeof(vector_t));
-      double new_x = (PAUSE_PLAY_RADIUS * cos(curr_angle)) + PAUSE_PLAY_LOC.x;
-      double new_y = (PAUSE_PLAY_RADIUS * sin(curr_angle)) + PAUSE_PLAY_LOC.y;
-      new_vec->x = new_x;
-      new_vec->y = new_y;
-      list_add(sides, new_vec);
-      curr_angle += angle_inc;
-    }
-    role_t *body_info = malloc(sizeof(role_t));
-    *body_info = (role_t)PAUSE_PLAY;
-    body_t *body = body_init_with_info(sides, INFINITY, RED, body_info, free);
-    scene_add_body(state->scene, body);
-
-    // draw two lines
-    body_t *left_rectangle = create_rectangle_body(
-        PAUSE_PLAY_LOC.x - PAUSE_LINE_WIDTH - PAUSE_LINE_WIDTH,
-        PAUSE_PLAY_LOC.y + (PAUSE_LINE_HEIGHT / 2), PAUSE_LINE_WIDTH,
-        PAUSE_LINE_HEIGHT, INFINITY, WHITE, PAUSE_PLAY, free);
-    body_t *right_triangle = create_rectangle_body(
-        PAUSE_PLAY_LOC.x + PAUSE_LINE_WIDTH,
-        PAUSE_PLAY_LOC.y + (PAUSE_LINE_HEIGHT / 2), PAUSE_LINE_WIDTH,
-        PAUSE_LINE_HEIGHT, INFINITY, WHITE, PAUSE_PLAY, free);
-    scene_add_body(state->scene, left_rectangle);
-    scene_add_body(state->scene, right_triangle);
+    ui_draw_widget(state, state->ui->pause_button);
+  }
+  // draw a play button
+  if (state->is_paused == true) {
+    ui_draw_widget(state, state->ui->play_button);
+  }
+}
+
+// draw circle to show which block is selected. the circle is only moved when
+// the selection changes
+void selected_block_circle(state_t *state) {
+  ui_t *ui = state->ui;
+  if (ui->circle_selection != state->block_selected) {
+    ui_widget_translate(
+        ui->selection_circle,
+        vec_subtract(selection_circle_center(state->block_selected),
+                     selection_circle_center(ui->circle_selection)));
+    ui->circle_selection = state->block_selected;
+  }
+  ui_draw_widget(state, ui->selection_circle);
+}
+
+void draw_hover_square(state_t *state) {
+  if (state->ui->hover_cell != NO_GRID_CELL) {
+    ui_draw_widget(state, state->ui->hover_square);
   }
-  // draw a play button
-  if (state->is_paused == true) {
-    // make background
-    double angle_inc = (TWO_PI) / PAUSE_PLAY_SIDES;
-    double curr_angle = 0.0;
-    list_t *sides = list_init(PAUSE_PLAY_SIDES, NULL);
-    for (size_t i = 0; i < PAUSE_PLAY_SIDES; i++) {
-      vector_t *new_vec = malloc(sizeof(vector_t));
-      double new_x = (PAUSE_PLAY_RADIUS * cos(curr_angle)) + PAUSE_PLAY_LOC.x;
-      double new_y = (PAUSE_PLAY_RADIUS * sin(curr_angle)) + PAUSE_PLAY_LOC.y;
-      new_vec->x = new_x;
-      new_vec->y = new_y;
-      list_add(sides, new_vec);
-      curr_angle += angle_inc;
-    }
-    role_t *body_info = malloc(sizeof(role_t));
-    *body_info = (role_t)PAUSE_PLAY;
-    body_t *body = body_init_with_info(sides, INFINITY, GREEN, body_info, free);
-    scene_add_body(state->scene, body);
-
-    // draw triangle
-    list_t *points = list_init(3, NULL);
-    angle_inc = (TWO_PI) / TRIANGLE_SIDES;
-    curr_angle = 0.0;
-    for (size_t i = 0; i < TRIANGLE_SIDES; i++) {
-      vector_t *new_vec = malloc(sizeof(vector_t));
-      double new_x =
-          (PLAY_TRIANGLE_RADIUS * cos(curr_angle)) + PAUSE_PLAY_LOC.x;
-      double new_y =
-          (PLAY_TRIANGLE_RADIUS * sin(curr_angle)) + PAUSE_PLAY_LOC.y;
-      new_vec->x = new_x;
-      new_vec->y = new_y;
-      list_add(points, new_vec);
-      curr_angle += angle_inc;
-    }
-    role_t *traingle_info = malloc(sizeof(role_t));
-    *traingle_info = (role_t)PAUSE_PLAY;
-    body_t *traingle =
-        body_init_with_info(points, INFINITY, WHITE, traingle_info, free);
-    scene_add_body(state->scene, traingle);
+}
+
+// draws the last frame's phases as one stacked bar, with a marker where a
+// frame runs out of its FIXED_DT budget
+void draw_profile_overlay(state_t *state) {
+  list_t *bars = state->ui->profile_bars;
+  double x = PROFILE_OVERLAY_LOC.x;
+  double top = PROFILE_OVERLAY_LOC.y + PROFILE_OVERLAY_HEIGHT;
+  for (size_t i = 0; i <= PHASE_SHOW; i++) {
+    ui_polygon_t *bar = list_get(bars, i);
+    double width = state->profiler->last[i] * 1000 * PROFILE_OVERLAY_SCALE;
+    rectangle_fill(bar->vertices, x, top, width, PROFILE_OVERLAY_HEIGHT);
+    x += width;
   }
+  ui_polygon_t *marker = list_get(bars, PHASE_SHOW + 1);
+  rectangle_fill(marker->vertices,
+                 PROFILE_OVERLAY_LOC.x +
+                     (FIXED_DT * 1000 * PROFILE_OVERLAY_SCALE),
+                 top, PROFILE_MARKER_WIDTH, PROFILE_OVERLAY_HEIGHT);
+  ui_draw_widget(state, bars);
 }
+#endif
 
 // get the row in the grid system
 size_t get_local_row(vector_t loc) {
@@ -443,50 +2543,27 @@ size_t get_local_col(vector_t loc) {
   return (size_t)(-1);
 }
 
-// draw a square where the mouse is hovering
-void hover_square(state_t *state, vector_t loc) {
-  // check if colored in square already exists
-  list_t *bodies = scene_get_all_bodies(state->scene);
-  for (size_t i = 0; i < list_size(bodies); i++) {
-    body_t *curr_body = list_get(bodies, i);
-    if (*(role_t *)body_get_info(curr_body) == HIGHLIGHTED_SQUARE) {
-      body_remove(curr_body);
-    }
+// get the index of the grid square that loc is in, or NO_GRID_CELL if loc is
+// not on the grid
+size_t get_grid_cell(vector_t loc) {
+  size_t row = get_local_row(loc);
+  size_t col = get_local_col(loc);
+  if (row == (size_t)(-1) || col == (size_t)(-1)) {
+    return NO_GRID_CELL;
   }
+  return (row * NUM_GRID_COLS) + col;
+}
 
+// draw a square where the mouse is hovering
+void hover_square(state_t *state, vector_t loc) {
+  size_t cell = get_grid_cell(loc);
   // check if egg is in spot
-  for (size_t i = 0; i < list_size(state->egg_grid_spots_x); i++) {
-    size_t curr_x = *((size_t *)(list_get(state->egg_grid_spots_x, i)));
-    if (curr_x == get_local_col(loc)) {
-      for (size_t j = 0; j < list_size(state->egg_grid_spots_y); j++) {
-        size_t curr_y = *((size_t *)(list_get(state->egg_grid_spots_y, j)));
-        if (curr_y == get_local_row(loc)) {
-          return;
-        }
-      }
-    }
-  }
-
-  if (state->game_state == BUILDING) {
-    // check if mouse in grid area
-    if (loc.x > GRID_BOTTOM_LEFT.x && loc.y > GRID_BOTTOM_LEFT.y) {
-      if (loc.x < GRID_BOTTOM_LEFT.x + (NUM_GRID_COLS * GRID_SQUARE_WIDTH) &&
-          loc.y < GRID_BOTTOM_LEFT.y + (NUM_GRID_ROWS * GRID_SQUARE_HEIGHT)) {
-        size_t row_idx = get_local_row(loc);
-        size_t col_idx = get_local_col(loc);
-        // create blue square
-        body_t *square = create_rectangle_body(
-            GRID_BOTTOM_LEFT.x + (col_idx * GRID_SQUARE_WIDTH) +
-                (GRID_LINE_THICKNESS / 2),
-            GRID_BOTTOM_LEFT.y + ((row_idx + 1) * GRID_SQUARE_HEIGHT) -
-                (GRID_LINE_THICKNESS / 2),
-            GRID_SQUARE_WIDTH - GRID_LINE_THICKNESS,
-            GRID_SQUARE_HEIGHT - GRID_LINE_THICKNESS, INFINITY,
-            HOVER_SQUARE_COLOR, HIGHLIGHTED_SQUARE, free);
-        scene_add_body(state->scene, square);
-      }
-    }
+  if (state->game_state != BUILDING ||
+      (cell != NO_GRID_CELL && state->grid[cell].occupied &&
+       state->grid[cell].material == EGG)) {
+    cell = NO_GRID_CELL;
   }
+  ui_set_hover_cell(state->ui, cell);
 }
 
 vector_t calc_initial_weapon_vel(double angle) {
@@ -495,47 +2572,53 @@ vector_t calc_initial_weapon_vel(double angle) {
   return (vector_t){.x = cos(angle) * magnitude, .y = sin(angle) * magnitude};
 }
 
-// checks if the given body is a block
-bool is_block(body_t *body) {
-  if (*(role_t *)body_get_info(body) == HAY ||
-      *(role_t *)body_get_info(body) == WOOD ||
-      *(role_t *)body_get_info(body) == STEEL ||
-      *(role_t *)body_get_info(body) == DIAMOND) {
-    return true;
-  }
-  return false;
+// checks to see if a block or the egg alr exists in that spot
+bool block_exists(state_t *state, vector_t loc) {
+  size_t cell = get_grid_cell(loc);
+  return cell != NO_GRID_CELL && state->grid[cell].occupied;
 }
 
-// checks to see if a block alr exists in that spot
-// not super efficient but this function is rarely called
-bool block_exists(state_t *state, vector_t loc) {
-  list_t *all_bodies = scene_get_all_bodies(state->scene);
-  for (size_t i = 0; i < list_size(all_bodies); i++) {
-    body_t *curr_body = list_get(all_bodies, i);
-    if (is_block(curr_body)) {
-      list_t *points = body_get_shape(curr_body);
-      vector_t top_left = *(vector_t *)(list_get(points, 0));
-      vector_t bottom_right = *(vector_t *)(list_get(points, 2));
-      if (loc.x < bottom_right.x && loc.x > top_left.x && loc.y < top_left.y &&
-          loc.y > bottom_right.y) {
-        return true;
-      }
-      list_free(points);
-    }
-  }
-  // check if egg is in spot
-  for (size_t i = 0; i < list_size(state->egg_grid_spots_x); i++) {
-    size_t curr_x = *((size_t *)(list_get(state->egg_grid_spots_x, i)));
-    if (curr_x == get_local_col(loc)) {
-      for (size_t j = 0; j < list_size(state->egg_grid_spots_y); j++) {
-        size_t curr_y = *((size_t *)(list_get(state->egg_grid_spots_y, j)));
-        if (curr_y == get_local_row(loc)) {
-          return true;
-        }
-      }
-    }
+// health, color and cost of a block material
+typedef struct block_kind {
+  double health;
+  rgb_color_t color;
+  size_t cost;
+} block_kind_t;
+
+// looks up the kind of a block material
+block_kind_t get_block_kind(role_t material) {
+  switch (material) {
+  case HAY:
+    return (block_kind_t){HAY_HEALTH, HAY_COLOR, HAY_COST};
+  case WOOD:
+    return (block_kind_t){WOOD_HEALTH, WOOD_COLOR, WOOD_COST};
+  case STEEL:
+    return (block_kind_t){STEEL_HEALTH, STEEL_COLOR, STEEL_COST};
+  case DIAMOND:
+    return (block_kind_t){DIAMOND_HEALTH, DIAMOND_COLOR, DIAMOND_COST};
+  default:
+    assert(false);
+    return (block_kind_t){0};
   }
-  return false;
+}
+
+// puts a block of the given material on an empty grid square
+void add_block(state_t *state, size_t row, size_t col, role_t material) {
+  size_t cell = (row * NUM_GRID_COLS) + col;
+  assert(cell < NUM_GRID_ROWS * NUM_GRID_COLS);
+  assert(state->grid[cell].occupied == false);
+  block_kind_t kind = get_block_kind(material);
+  body_t *square = create_rectangle_body(
+      state,
+      GRID_BOTTOM_LEFT.x + (col * GRID_SQUARE_WIDTH) +
+          (GRID_LINE_THICKNESS / 2),
+      GRID_BOTTOM_LEFT.y + ((row + 1) * GRID_SQUARE_HEIGHT) -
+          (GRID_LINE_THICKNESS / 2),
+      GRID_SQUARE_WIDTH - GRID_LINE_THICKNESS,
+      GRID_SQUARE_HEIGHT - GRID_LINE_THICKNESS, INFINITY, kind.color,
+      material);
+  body_set_health(square, kind.health);
+  game_add_block(state, square, cell);
 }
 
 // place a block on the grid
@@ -543,43 +2626,10 @@ void place_block(state_t *state, vector_t loc) {
   if (loc.x > GRID_BOTTOM_LEFT.x && loc.y > GRID_BOTTOM_LEFT.y) {
     if (loc.x < GRID_BOTTOM_LEFT.x + (NUM_GRID_COLS * GRID_SQUARE_WIDTH) &&
         loc.y < GRID_BOTTOM_LEFT.y + (NUM_GRID_ROWS * GRID_SQUARE_HEIGHT)) {
-      double block_health = 0;
-      rgb_color_t block_color;
-      size_t cost = 0;
-      switch (state->block_selected) {
-      case HAY:
-        block_health = HAY_HEALTH;
-        block_color = HAY_COLOR;
-        cost = HAY_COST;
-        break;
-      case WOOD:
-        block_health = WOOD_HEALTH;
-        block_color = WOOD_COLOR;
-        cost = WOOD_COST;
-        break;
-      case STEEL:
-        block_health = STEEL_HEALTH;
-        block_color = STEEL_COLOR;
-        cost = STEEL_COST;
-        break;
-      case DIAMOND:
-        block_health = DIAMOND_HEALTH;
-        block_color = DIAMOND_COLOR;
-        cost = DIAMOND_COST;
-        break;
-      }
+      role_t material = (role_t)(state->block_selected);
+      size_t cost = get_block_kind(material).cost;
       if (block_exists(state, loc) == false && state->credits > cost) {
-        body_t *square = create_rectangle_body(
-            GRID_BOTTOM_LEFT.x + (get_local_col(loc) * GRID_SQUARE_WIDTH) +
-                (GRID_LINE_THICKNESS / 2),
-            GRID_BOTTOM_LEFT.y +
-                ((get_local_row(loc) + 1) * GRID_SQUARE_HEIGHT) -
-                (GRID_LINE_THICKNESS / 2),
-            GRID_SQUARE_WIDTH - GRID_LINE_THICKNESS,
-            GRID_SQUARE_HEIGHT - GRID_LINE_THICKNESS, INFINITY, block_color,
-            (role_t)(state->block_selected), free);
-        body_set_health(square, block_health);
-        scene_add_body(state->scene, square);
+        add_block(state, get_local_row(loc), get_local_col(loc), material);
         state->credits -= cost;
       }
     }
@@ -587,25 +2637,13 @@ void place_block(state_t *state, vector_t loc) {
 }
 
 void remove_block(state_t *state, vector_t loc) {
-  if (loc.x > GRID_BOTTOM_LEFT.x && loc.y > GRID_BOTTOM_LEFT.y) {
-    if (loc.x < GRID_BOTTOM_LEFT.x + (NUM_GRID_COLS * GRID_SQUARE_WIDTH) &&
-        loc.y < GRID_BOTTOM_LEFT.y + (NUM_GRID_ROWS * GRID_SQUARE_HEIGHT)) {
-      list_t *all_bodies = scene_get_all_bodies(state->scene);
-      for (size_t i = 0; i < list_size(all_bodies); i++) {
-        body_t *curr_body = list_get(all_bodies, i);
-        if (is_block(curr_body)) {
-          list_t *points = body_get_shape(curr_body);
-          vector_t top_left = *(vector_t *)(list_get(points, 0));
-          vector_t bottom_right = *(vector_t *)(list_get(points, 2));
-          if (loc.x < bottom_right.x && loc.x > top_left.x &&
-              loc.y < top_left.y && loc.y > bottom_right.y) {
-            body_remove(curr_body);
-          }
-          list_free(points);
-        }
-      }
-    }
+  size_t cell = get_grid_cell(loc);
+  if (cell == NO_GRID_CELL || state->grid[cell].occupied == false ||
+      state->grid[cell].material == EGG) {
+    return;
   }
+  body_table_remove(state->bodies, state->grid[cell].block);
+  state->grid[cell] = (grid_cell_t){.occupied = false, .block = NO_BODY};
 }
 
 void set_game_over(state_t *state) {
@@ -616,22 +2654,19 @@ void set_game_over(state_t *state) {
 
 // remove weapons that are out of bounds
 void remove_weapons_out_of_bounds(state_t *state) {
-  list_t *all_bodies = scene_get_all_bodies(state->scene);
-  for (size_t i = 0; i < list_size(all_bodies); i++) {
-    body_t *curr_body = list_get(all_bodies, i);
-    if (*(role_t *)body_get_info(curr_body) == WEAPON) {
-      list_t *shape = body_get_shape(curr_body);
-      for (size_t j = 0; j < list_size(shape); j++) {
-        if (((vector_t *)list_get(shape, j))->x > GRID_BOTTOM_LEFT.x) {
-          if (((vector_t *)list_get(shape, j))->x >
-                  WINDOW.x - MENU_WIDTH - (MENU_BORDER_WIDTH / 2) ||
-              ((vector_t *)list_get(shape, j))->x < 0 ||
-              ((vector_t *)list_get(shape, j))->y < ISLAND_HEIGHT) {
-            body_remove(curr_body);
-          }
+  body_table_t *table = state->bodies;
+  role_set_t *weapons = body_table_role(table, WEAPON);
+  for (size_t i = 0; i < weapons->size; i++) {
+    shape_view_t shape = body_table_shape(table, weapons->indices[i]);
+    for (size_t j = 0; j < shape.size; j++) {
+      if (shape.vertices[j].x > GRID_BOTTOM_LEFT.x) {
+        if (shape.vertices[j].x >
+                WINDOW.x - MENU_WIDTH - (MENU_BORDER_WIDTH / 2) ||
+            shape.vertices[j].x < 0 || shape.vertices[j].y < ISLAND_HEIGHT) {
+          body_table_remove(table, table->handles[weapons->indices[i]]);
+          break;
         }
       }
-      list_free(shape);
     }
   }
 }
@@ -643,34 +2678,33 @@ size_t calc_credits(size_t level) {
              CREDIT_ADDITION)));
 }
 
-body_t *create_weapon(size_t sides, double weapon_mass) {
-  list_t *points = list_init(sides, free);
-  double curr_angle = 0.0;
-  double angle_inc = (TWO_PI) / sides;
+// picks a weapon's launch angle and spin. only the descriptor is kept until
+// the weapon is launched
+weapon_desc_t roll_weapon(state_t *state, size_t sides, double weapon_mass) {
+  size_t launch_angle = (rng_next(&state->rng) %
+                         (WEAPON_ANGLE_MAX_RAD - WEAPON_ANGLE_MIN_RAD + 1)) +
+                        WEAPON_ANGLE_MIN_RAD;
+  size_t random_angle = (rng_next(&state->rng) % (360));
+  return (weapon_desc_t){.sides = sides,
+                         .mass = weapon_mass,
+                         .launch_angle = (launch_angle * PI) / 180,
+                         .rotation = (random_angle * PI) / 180};
+}
+
+body_t *create_weapon(state_t *state, weapon_desc_t desc) {
   vector_t spawn_loc = (vector_t){.x = WEAPON_SPAWN_X, .y = EGG_CENTROID.y};
-  for (size_t i = 0; i < sides; i++) {
-    double x_val = (WEAPON_RADIUS * cos(curr_angle)) + spawn_loc.x;
-    double y_val = (WEAPON_RADIUS * sin(curr_angle)) + spawn_loc.y;
-    vector_t *new_point = malloc(sizeof(vector_t));
-    new_point->x = x_val;
-    new_point->y = y_val;
-    list_add(points, new_point);
-    curr_angle += angle_inc;
-  }
-  role_t *body_info = malloc(sizeof(role_t));
-  *body_info = (role_t)(WEAPON);
-  body_t *body =
-      body_init_with_info(points, weapon_mass, WEAPON_COLOR, body_info, free);
-
-  size_t launch_angle =
-      (rand() % (WEAPON_ANGLE_MAX_RAD - WEAPON_ANGLE_MIN_RAD + 1)) +
-      WEAPON_ANGLE_MIN_RAD;
-  double launch_angle_rad = (launch_angle * PI) / 180;
-  body_set_velocity(body, calc_initial_weapon_vel(launch_angle_rad));
-
-  size_t random_angle = (rand() % (360));
-  double random_angle_rad = (random_angle * PI) / 180;
-  body_set_rotation(body, random_angle_rad);
+
+  // the random spin is part of placing the prototype, so the vertices are
+  // only written once
+  const shape_prototype_t *prototype =
+      shape_prototype_get(state->prototypes, desc.sides);
+  body_info_t *body_info = body_info_alloc(state->memory, WEAPON, desc.sides);
+  shape_prototype_place(prototype, WEAPON_RADIUS, desc.rotation, spawn_loc,
+                        body_info->vertices);
+  body_info->prototype = prototype;
+  body_info->scale = WEAPON_RADIUS;
+  body_t *body = create_polygon_body(body_info, desc.mass, WEAPON_COLOR);
+  body_set_velocity(body, calc_initial_weapon_vel(desc.launch_angle));
 
   return body;
 }
@@ -679,7 +2713,8 @@ void calc_circles(state_t *state) {
   size_t curr_level = state->level;
   size_t num_objs = round(CIRCLES_PER_LEVEL * curr_level) + MIN_NUM_CIRCLES;
   for (size_t i = 0; i < num_objs; i++) {
-    list_add(state->weapon_queue, create_weapon(CIRCLE_SIDES, CIRCLE_MASS));
+    weapon_queue_push(state->weapon_queue,
+                      roll_weapon(state, CIRCLE_SIDES, CIRCLE_MASS));
   }
 }
 
@@ -687,7 +2722,8 @@ void calc_triangles(state_t *state) {
   size_t curr_level = state->level;
   size_t num_objs = round(TRIANGLES_PER_LEVEL * curr_level) + MIN_NUM_TRIANGLES;
   for (size_t i = 0; i < num_objs; i++) {
-    list_add(state->weapon_queue, create_weapon(TRIANGLE_SIDES, TRIANGLE_MASS));
+    weapon_queue_push(state->weapon_queue,
+                      roll_weapon(state, TRIANGLE_SIDES, TRIANGLE_MASS));
   }
 }
 
@@ -696,84 +2732,436 @@ void calc_squares(state_t *state) {
   size_t num_objs =
       round(pow(SQUARES_BASE, (double)curr_level) - SQUARES_SUBTRACT);
   for (size_t i = 0; i < num_objs; i++) {
-    list_add(state->weapon_queue, create_weapon(SQUARE_SIDES, SQUARE_MASS));
+    weapon_queue_push(state->weapon_queue,
+                      roll_weapon(state, SQUARE_SIDES, SQUARE_MASS));
   }
 }
 
-// draw circle to show which block is selected
-void selected_block_circle(state_t *state) {
-  // remove previous selection
-  list_t *bodies = scene_get_all_bodies(state->scene);
-  for (size_t i = 0; i < list_size(bodies); i++) {
-    body_t *curr_body = list_get(bodies, i);
-    if (*(role_t *)body_get_info(curr_body) == SELECTION_CIRCLE) {
-      body_remove(curr_body);
+// adds the appropriate number of each projectile
+void start_shooting(state_t *state) {
+  state->contact_pairs = 0;
+  region_advance(state->memory->wave);
+  calc_circles(state);
+  calc_triangles(state);
+  calc_squares(state);
+}
+
+// start of a snapshot. the counts say how many records follow
+typedef struct snapshot_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t body_size; // sizeof(snapshot_body_t) in the build that wrote it
+  uint32_t weapon_size; // sizeof(weapon_desc_t) in the build that wrote it
+  uint32_t reserved;
+  uint64_t num_bodies; // bodies in the scene
+  uint64_t num_queued; // weapons waiting to be launched
+  uint64_t num_vertices;
+  uint64_t rng_state;
+  uint64_t level;
+  uint64_t credits;
+  uint64_t contact_pairs;
+  int32_t game_state;
+  int32_t block_selected;
+  uint32_t game_over;
+  uint32_t is_paused;
+  double last_weapon_time;
+  double total_time_elapsed;
+  double egg_health;
+} snapshot_header_t;
+
+// one body. its vertices are num_vertices entries of the vertex array from
+// first_vertex on
+typedef struct snapshot_body {
+  int32_t role;
+  uint32_t num_vertices;
+  uint64_t first_vertex;
+  uint64_t grid_cell;
+  double mass;
+  double health;
+  vector_t velocity;
+  double rest_time;
+  double scale;
+  uint32_t asleep;
+  uint32_t prototype_sides; // 0 if the body wasn't placed from a prototype
+  rgb_color_t color;
+  uint32_t reserved; // fills what would be padding, so every byte is set
+} snapshot_body_t;
+
+void snapshot_body_write(snapshot_body_t *record, body_t *body,
+                         size_t grid_cell, double rest_time, bool asleep,
+                         vector_t *vertices, size_t *num_vertices) {
+  body_info_t *info = body_get_info(body);
+  *record = (snapshot_body_t){
+      .role = info->role,
+      .num_vertices = info->num_vertices,
+      .first_vertex = *num_vertices,
+      .grid_cell = grid_cell,
+      .mass = body_get_mass(body),
+      .health = body_get_health(body),
+      .velocity = body_get_velocity(body),
+      .rest_time = rest_time,
+      .scale = info->scale,
+      .asleep = asleep,
+      .prototype_sides =
+          info->prototype == NULL ? 0 : info->prototype->sides,
+      .color = body_get_color(body)};
+  memcpy(&vertices[*num_vertices], info->vertices,
+         info->num_vertices * sizeof(vector_t));
+  *num_vertices += info->num_vertices;
+}
+
+// saves the scene's bodies, the weapon queue and the game's progress. the
+// scenery never changes, so it is left out. the bytes are a
+// snapshot_header_t, a snapshot_body_t for every body in the scene, a
+// weapon_desc_t for every queued weapon, and the bodies' vertices. the
+// records are fixed size
+// and in native byte order, so a snapshot can be mapped straight from a file
+// and restored without parsing
+snapshot_t snapshot_capture(state_t *state) {
+  // bodies waiting in the removal queue would be gone by the next tick, so
+  // they are removed now and left out
+  body_table_t *table = state->bodies;
+  body_table_flush(table, state->grid);
+  size_t num_bodies = table->size;
+  size_t num_vertices = 0;
+  for (size_t i = 0; i < table->size; i++) {
+    num_vertices += table->num_vertices[i];
+  }
+  size_t num_queued = state->weapon_queue->size;
+
+  snapshot_t snapshot;
+  snapshot.size = sizeof(snapshot_header_t) +
+                  (num_bodies * sizeof(snapshot_body_t)) +
+                  (num_queued * sizeof(weapon_desc_t)) +
+                  (num_vertices * sizeof(vector_t));
+  snapshot.data = malloc(snapshot.size);
+  assert(snapshot.data != NULL);
+  snapshot_header_t *header = snapshot.data;
+  snapshot_body_t *records = (snapshot_body_t *)(header + 1);
+  weapon_desc_t *weapons = (weapon_desc_t *)(records + num_bodies);
+  vector_t *vertices = (vector_t *)(weapons + num_queued);
+
+  *header = (snapshot_header_t){.version = SNAPSHOT_VERSION,
+                                .body_size = sizeof(snapshot_body_t),
+                                .weapon_size = sizeof(weapon_desc_t),
+                                .num_bodies = num_bodies,
+                                .num_queued = num_queued,
+                                .num_vertices = num_vertices,
+                                .rng_state = state->rng.state,
+                                .level = state->level,
+                                .credits = state->credits,
+                                .contact_pairs = state->contact_pairs,
+                                .game_state = state->game_state,
+                                .block_selected = state->block_selected,
+                                .game_over = state->game_over,
+                                .is_paused = state->is_paused,
+                                .last_weapon_time = state->last_weapon_time,
+                                .total_time_elapsed = state->total_time_elapsed,
+                                .egg_health = state->egg_health};
+  memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic));
+
+  // the bodies are saved in the scene's order, so a restored scene ticks
+  // them in the same order
+  size_t num_records = 0;
+  num_vertices = 0;
+  for (size_t i = 0; i < table->order_size; i++) {
+    size_t idx;
+    if (body_table_find(table, table->order[i].handle, &idx)) {
+      snapshot_body_write(&records[num_records], table->bodies[idx],
+                          table->grid_cells[idx], table->rest_times[idx],
+                          table->asleep[idx], vertices, &num_vertices);
+      num_records++;
     }
   }
+  for (size_t i = 0; i < num_queued; i++) {
+    weapons[i] = weapon_queue_get(state->weapon_queue, i);
+  }
+  return snapshot;
+}
 
-  double spawn_loc_x = ((WINDOW.x - SELECTION_SEPARATION) +
-                        (WINDOW.x - (MENU_WIDTH / 2) + (MENU_BLOCK_DIM / 2))) /
-                       2;
-  double spawn_loc_y = WINDOW.y - SELECTION_SEPARATION - (SELECTION_HEIGHT / 2);
-  if (state->block_selected == WOOD) {
-    spawn_loc_y -= (WOOD_INDEX * (SELECTION_HEIGHT + SELECTION_SEPARATION));
+body_t *snapshot_body_create(state_t *state, const snapshot_body_t *record,
+                             const vector_t *vertices) {
+  body_info_t *info =
+      body_info_alloc(state->memory, record->role, record->num_vertices);
+  memcpy(info->vertices, &vertices[record->first_vertex],
+         record->num_vertices * sizeof(vector_t));
+  if (record->prototype_sides != 0) {
+    info->prototype =
+        shape_prototype_get(state->prototypes, record->prototype_sides);
+    info->scale = record->scale;
   }
-  if (state->block_selected == STEEL) {
-    spawn_loc_y -= (STEEL_INDEX * (SELECTION_HEIGHT + SELECTION_SEPARATION));
+  body_t *body = create_polygon_body(info, record->mass, record->color);
+  body_set_health(body, record->health);
+  body_set_velocity(body, record->velocity);
+  return body;
+}
+
+// takes count items of item_size bytes off the size left in a snapshot.
+// returns false if they don't fit, without overflowing on a huge count
+bool snapshot_take(size_t *remaining, uint64_t count, size_t item_size) {
+  if (count > *remaining / item_size) {
+    return false;
   }
-  if (state->block_selected == DIAMOND) {
-    spawn_loc_y -= (DIAMOND_INDEX * (SELECTION_HEIGHT + SELECTION_SEPARATION));
+  *remaining -= count * item_size;
+  return true;
+}
+
+// the roles of the bodies snapshot_capture writes. scenery and ui never go in
+// the body table, so a snapshot can't hold them
+const role_t SNAPSHOT_ROLES[] = {EGG, WEAPON, HAY, WOOD, STEEL, DIAMOND};
+const size_t NUM_SNAPSHOT_ROLES =
+    sizeof(SNAPSHOT_ROLES) / sizeof(SNAPSHOT_ROLES[0]);
+
+// true if value is the role of a body a snapshot can hold. takes the raw
+// value from the file, which might not be a role at all
+bool is_snapshot_role(int64_t value) {
+  for (size_t i = 0; i < NUM_SNAPSHOT_ROLES; i++) {
+    if (SNAPSHOT_ROLES[i] == value) {
+      return true;
+    }
   }
-  list_t *points = list_init(SELECTION_CIRCLE_SIDES, free);
-  double curr_angle = 0.0;
-  double angle_inc = (TWO_PI) / SELECTION_CIRCLE_SIDES;
-  for (size_t i = 0; i < SELECTION_CIRCLE_SIDES; i++) {
-    double x_val = (SELECTION_CIRCLE_RADIUS * cos(curr_angle)) + spawn_loc_x;
-    double y_val = (SELECTION_CIRCLE_RADIUS * sin(curr_angle)) + spawn_loc_y;
-    vector_t *new_point = malloc(sizeof(vector_t));
-    new_point->x = x_val;
-    new_point->y = y_val;
-    list_add(points, new_point);
-    curr_angle += angle_inc;
-  }
-  role_t *body_info = malloc(sizeof(role_t));
-  *body_info = (role_t)(SELECTION_CIRCLE);
-  body_t *body = body_init_with_info(points, INFINITY, BLACK, body_info, free);
-  scene_add_body(state->scene, body);
+  return false;
 }
 
-// adds the appropriate number of each projectile
-void start_shooting(state_t *state) {
-  calc_circles(state);
-  calc_triangles(state);
-  calc_squares(state);
+// true if a weapon with this many sides is one the game rolls. anything else
+// in a snapshot is corrupt, and a huge count would build a huge prototype
+bool is_weapon_sides(uint64_t sides) {
+  return sides == TRIANGLE_SIDES || sides == SQUARE_SIDES ||
+         sides == CIRCLE_SIDES;
 }
 
-// restart the game
-void restart(state_t *state) {
-  // remove all bodies
-  list_t *all_bodies = scene_get_all_bodies(state->scene);
-  for (size_t i = 0; i < list_size(all_bodies); i++) {
-    body_remove(list_get(all_bodies, i));
+// true if a body record can be rebuilt without tripping any of the asserts
+// that the game's own bodies never reach
+bool snapshot_body_valid(const snapshot_body_t *record,
+                         uint64_t num_vertices) {
+  if (is_snapshot_role(record->role) == false || record->num_vertices < 3 ||
+      record->first_vertex > num_vertices ||
+      record->num_vertices > num_vertices - record->first_vertex) {
+    return false;
   }
+  if (is_block_role(record->role) &&
+      record->num_vertices != BLOCK_VERTICES) {
+    return false;
+  }
+  if (record->grid_cell != NO_GRID_CELL &&
+      (record->grid_cell >= NUM_GRID_ROWS * NUM_GRID_COLS ||
+       (is_block_role(record->role) == false && record->role != EGG))) {
+    return false;
+  }
+  return record->prototype_sides == 0 ||
+         (is_weapon_sides(record->prototype_sides) &&
+          record->prototype_sides == record->num_vertices);
+}
 
-  // reset other values
-  state->game_state = BUILDING;
-  state->last_weapon_time = 0.0;
-  state->total_time_elapsed = 0.0;
-  state->block_selected = HAY;
-  state->weapon_queue = list_init(1, free);
-  state->level = STARTING_LEVEL;
-  state->credits = calc_credits(STARTING_LEVEL);
-  state->egg_health = EGG_HEALTH;
-  state->game_over = false;
-  state->is_paused = true;
+// replaces the scene's bodies, the weapon queue and the game's progress with
+// the ones in a snapshot. the old bodies are removed and go away on the next
+// scene_tick. returns false and changes nothing if the data isn't a snapshot
+// this build can read
+bool snapshot_restore(state_t *state, const void *data, size_t size) {
+  const snapshot_header_t *header = data;
+  if (size < sizeof(snapshot_header_t) ||
+      memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != SNAPSHOT_VERSION ||
+      header->body_size != sizeof(snapshot_body_t) ||
+      header->weapon_size != sizeof(weapon_desc_t) ||
+      (header->game_state != BUILDING && header->game_state != SHOOTING) ||
+      is_block_role(header->block_selected) == false) {
+    return false;
+  }
+  size_t remaining = size - sizeof(snapshot_header_t);
+  bool fits =
+      snapshot_take(&remaining, header->num_bodies, sizeof(snapshot_body_t)) &&
+      snapshot_take(&remaining, header->num_queued, sizeof(weapon_desc_t)) &&
+      snapshot_take(&remaining, header->num_vertices, sizeof(vector_t));
+  if (fits == false || remaining != 0) {
+    return false;
+  }
+  const snapshot_body_t *records = (const snapshot_body_t *)(header + 1);
+  const weapon_desc_t *weapons =
+      (const weapon_desc_t *)(records + header->num_bodies);
+  const vector_t *vertices = (const vector_t *)(weapons + header->num_queued);
+  for (size_t i = 0; i < header->num_bodies; i++) {
+    if (snapshot_body_valid(&records[i], header->num_vertices) == false) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < header->num_queued; i++) {
+    if (is_weapon_sides(weapons[i].sides) == false) {
+      return false;
+    }
+  }
+
+  body_table_t *table = state->bodies;
+  for (size_t i = 0; i < table->size; i++) {
+    body_table_remove(table, table->handles[i]);
+  }
+  body_table_flush(table, state->grid);
+  for (size_t i = 0; i < NUM_GRID_ROWS * NUM_GRID_COLS; i++) {
+    state->grid[i] = (grid_cell_t){.occupied = false, .block = NO_BODY};
+  }
+  weapon_queue_clear(state->weapon_queue);
+  region_advance(state->memory->level);
+  region_advance(state->memory->wave);
+
+  state->rng.state = header->rng_state;
+  state->level = header->level;
+  state->credits = header->credits;
+  state->contact_pairs = header->contact_pairs;
+  state->game_state = header->game_state;
+  state->block_selected = header->block_selected;
+  state->game_over = header->game_over;
+  state->is_paused = header->is_paused;
+  state->last_weapon_time = header->last_weapon_time;
+  state->total_time_elapsed = header->total_time_elapsed;
+  state->egg_health = header->egg_health;
+
+  for (size_t i = 0; i < header->num_bodies; i++) {
+    body_t *body = snapshot_body_create(state, &records[i], vertices);
+    if (records[i].grid_cell != NO_GRID_CELL) {
+      game_add_block(state, body, records[i].grid_cell);
+    } else {
+      game_add_body(state, body);
+    }
+    if (records[i].role == EGG) {
+      mark_egg_squares(state, body);
+    }
+    table->rest_times[table->size - 1] = records[i].rest_time;
+    table->asleep[table->size - 1] = records[i].asleep;
+  }
+  for (size_t i = 0; i < header->num_queued; i++) {
+    weapon_queue_push(state->weapon_queue, weapons[i]);
+  }
+  return true;
+}
+
+void snapshot_free(snapshot_t snapshot) { free(snapshot.data); }
+
+bool snapshot_save(state_t *state, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  snapshot_t snapshot = snapshot_capture(state);
+  bool written = fwrite(snapshot.data, 1, snapshot.size, file) == snapshot.size;
+  snapshot_free(snapshot);
+  return fclose(file) == 0 && written;
+}
+
+// maps a snapshot file and restores it in place
+bool snapshot_load(state_t *state, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  bool restored = snapshot_restore(state, data, info.st_size);
+  munmap(data, info.st_size);
+  return restored;
+}
+
+// fnv-1a hash of a block of bytes
+uint64_t hash_bytes(const void *data, size_t size) {
+  const unsigned char *bytes = data;
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// hash of everything a snapshot holds, to tell whether two runs ended up in
+// exactly the same place
+uint64_t game_checksum(state_t *state) {
+  snapshot_t snapshot = snapshot_capture(state);
+  uint64_t hash = hash_bytes(snapshot.data, snapshot.size);
+  snapshot_free(snapshot);
+  return hash;
+}
+
+// start of a recording file, followed by num_events input_event_t. the
+// checksum is of the game when it was saved, after num_ticks ticks
+typedef struct recording_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t event_size;
+  uint64_t seed;
+  uint64_t num_events;
+  uint64_t num_ticks;
+  uint64_t checksum;
+} recording_header_t;
+
+bool recording_save(state_t *state, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  recording_t *recording = &state->recording;
+  recording_header_t header = {.version = RECORDING_VERSION,
+                               .event_size = sizeof(input_event_t),
+                               .seed = recording->seed,
+                               .num_events = recording->size,
+                               .num_ticks = state->ticks,
+                               .checksum = game_checksum(state)};
+  memcpy(header.magic, RECORDING_MAGIC, sizeof(header.magic));
+  bool written =
+      fwrite(&header, sizeof(header), 1, file) == 1 &&
+      fwrite(recording->events, sizeof(input_event_t), recording->size,
+             file) == recording->size;
+  return fclose(file) == 0 && written;
+}
+
+// reads a recording's header and events. the events are malloced and left to
+// the caller. the event count has to match the file's size, so a bad header
+// can't ask for a huge allocation
+bool recording_load(const char *path, recording_header_t *header,
+                    input_event_t **events) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(fileno(file), &info) != 0 ||
+      (size_t)info.st_size < sizeof(recording_header_t) ||
+      fread(header, sizeof(recording_header_t), 1, file) != 1 ||
+      memcmp(header->magic, RECORDING_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != RECORDING_VERSION ||
+      header->event_size != sizeof(input_event_t)) {
+    fclose(file);
+    return false;
+  }
+  size_t remaining = info.st_size - sizeof(recording_header_t);
+  if (header->num_events != remaining / sizeof(input_event_t) ||
+      remaining % sizeof(input_event_t) != 0) {
+    fclose(file);
+    return false;
+  }
+  *events = malloc((header->num_events + 1) * sizeof(input_event_t));
+  assert(*events != NULL);
+  bool read = fread(*events, sizeof(input_event_t), header->num_events,
+                    file) == header->num_events;
+  fclose(file);
+  if (read == false) {
+    free(*events);
+  }
+  return read;
+}
 
-  create_background(state->scene);
-  create_island(state->scene);
-  create_menu(state->scene);
-  create_egg(state->scene);
-  create_grid(state->scene);
+// restart the game from the snapshot game_init took. the random numbers carry
+// on instead of replaying the first game's waves
+void restart(state_t *state) {
+  rng_t rng = state->rng;
+  bool restored = snapshot_restore(state, state->start.data, state->start.size);
+  assert(restored);
+  state->rng = rng;
 }
 
 // convert smt on system where 0,0 is top right to system where 0,0 is bottom
@@ -800,61 +3188,569 @@ void p_key_behavior(state_t *state) {
   }
 }
 
-void on_key(char key, key_event_type_t type, double held_time, state_t *state,
-            vector_t loc, size_t button_type) {
-  if (type == KEY_PRESSED) {
-    // for some reason, the 0,0 is on the top left instead of buttom left when
-    // mouse is clicked. reverse this so that 0,0 is the bottom left
-    switch (key) {
-    case MOUSE_CLICK:
-      if (button_type == (role_t)(SDL_BUTTON_LEFT)) {
-        if (state->game_state == BUILDING && state->game_over == false) {
-          place_block(state, corrected_loc(loc));
-        }
-        if (vec_l2norm(corrected_loc(loc), PAUSE_PLAY_LOC) <=
-            PAUSE_PLAY_RADIUS) {
-          p_key_behavior(state);
-        }
-      }
-      if (button_type == (role_t)(SDL_BUTTON_RIGHT)) {
-        if (state->game_state == BUILDING && state->game_over == false) {
-          remove_block(state, corrected_loc(loc));
-        }
-      }
+// applies a key press or click. everything that changes the game goes
+// through here, so replaying the recorded events replays the game
+void game_handle_input(state_t *state, input_event_t event) {
+  vector_t loc = event.loc;
+  // for some reason, the 0,0 is on the top left instead of buttom left when
+  // mouse is clicked. reverse this so that 0,0 is the bottom left
+  switch (event.key) {
+  case MOUSE_CLICK:
+    if (event.button == (role_t)(SDL_BUTTON_LEFT)) {
+      if (state->game_state == BUILDING && state->game_over == false) {
+        place_block(state, corrected_loc(loc));
+      }
+      if (vec_l2norm(corrected_loc(loc), PAUSE_PLAY_LOC) <=
+          PAUSE_PLAY_RADIUS) {
+        p_key_behavior(state);
+      }
+    }
+    if (event.button == (role_t)(SDL_BUTTON_RIGHT)) {
+      if (state->game_state == BUILDING && state->game_over == false) {
+        remove_block(state, corrected_loc(loc));
+      }
+    }
+
+    break;
+  case P_KEY:
+    p_key_behavior(state);
+    break;
+  case ONE:
+    state->block_selected = HAY;
+    break;
+  case TWO:
+    state->block_selected = WOOD;
+    break;
+  case THREE:
+    state->block_selected = STEEL;
+    break;
+  case FOUR:
+    state->block_selected = DIAMOND;
+    break;
+  }
+}
+
+// records presses before applying them. moving the mouse only moves the
+// hover square, so it isn't recorded
+void on_key(char key, key_event_type_t type, double held_time, state_t *state,
+            vector_t loc, size_t button_type) {
+  if (type != KEY_PRESSED) {
+    return;
+  }
+  if (key == MOUSE_MOVED) {
+    if (state->game_over == false) {
+      hover_square(state, corrected_loc(loc));
+    }
+    return;
+  }
+  input_event_t event = (input_event_t){
+      .tick = state->ticks, .key = key, .button = button_type, .loc = loc};
+  recording_add(&state->recording, event);
+  game_handle_input(state, event);
+}
+
+aabb_t shape_bounds(shape_view_t shape) {
+  return points_bounds(shape.vertices, shape.size);
+}
+
+// bounds of a body. bodies placed from a prototype are bounded by the circle
+// around their centroid, so their vertices are not read
+aabb_t body_bounds(body_table_t *table, size_t idx) {
+  body_info_t *info = body_get_info(table->bodies[idx]);
+  if (info->prototype == NULL) {
+    return shape_bounds(body_table_shape(table, idx));
+  }
+  double radius = info->prototype->bounding_radius * info->scale;
+  vector_t extent = (vector_t){.x = radius, .y = radius};
+  return (aabb_t){.min = vec_subtract(table->centroids[idx], extent),
+                  .max = vec_add(table->centroids[idx], extent)};
+}
+
+// finds the range of grid squares that bounds overlaps. returns false if it
+// does not overlap the grid at all
+bool grid_range(aabb_t bounds, size_t *min_row, size_t *max_row,
+                size_t *min_col, size_t *max_col) {
+  double left = (bounds.min.x - GRID_BOTTOM_LEFT.x) / GRID_SQUARE_WIDTH;
+  double right = (bounds.max.x - GRID_BOTTOM_LEFT.x) / GRID_SQUARE_WIDTH;
+  double bottom = (bounds.min.y - GRID_BOTTOM_LEFT.y) / GRID_SQUARE_HEIGHT;
+  double top = (bounds.max.y - GRID_BOTTOM_LEFT.y) / GRID_SQUARE_HEIGHT;
+  if (right < 0 || top < 0 || left >= NUM_GRID_COLS ||
+      bottom >= NUM_GRID_ROWS) {
+    return false;
+  }
+  *min_col = left < 0 ? 0 : (size_t)left;
+  *min_row = bottom < 0 ? 0 : (size_t)bottom;
+  *max_col = right >= NUM_GRID_COLS ? NUM_GRID_COLS - 1 : (size_t)right;
+  *max_row = top >= NUM_GRID_ROWS ? NUM_GRID_ROWS - 1 : (size_t)top;
+  return true;
+}
+
+// the bounds of the block on a grid square, as add_block places it
+aabb_t block_bounds(size_t row, size_t col) {
+  vector_t min = (vector_t){
+      .x = GRID_BOTTOM_LEFT.x + (col * GRID_SQUARE_WIDTH) +
+           (GRID_LINE_THICKNESS / 2),
+      .y = GRID_BOTTOM_LEFT.y + (row * GRID_SQUARE_HEIGHT) +
+           (GRID_LINE_THICKNESS / 2)};
+  vector_t size = (vector_t){.x = GRID_SQUARE_WIDTH - GRID_LINE_THICKNESS,
+                             .y = GRID_SQUARE_HEIGHT - GRID_LINE_THICKNESS};
+  return (aabb_t){.min = min, .max = vec_add(min, size)};
+}
+
+// narrows [*enter, *exit] to the times at which start + t * motion lies
+// between min and max along one axis. returns false if the range empties
+bool sweep_slab(double start, double motion, double min, double max,
+                double *enter, double *exit) {
+  if (motion == 0) {
+    return start >= min && start <= max;
+  }
+  double t1 = (min - start) / motion;
+  double t2 = (max - start) / motion;
+  *enter = fmax(*enter, fmin(t1, t2));
+  *exit = fmin(*exit, fmax(t1, t2));
+  return *enter <= *exit;
+}
+
+// the sweep_* functions return the first time in (0, 1] at which a point
+// moving from start to start + motion enters a region, or INFINITY if it
+// doesn't, including when it starts inside
+
+double sweep_box(vector_t start, vector_t motion, aabb_t box) {
+  double enter = 0.0;
+  double exit = 1.0;
+  if (sweep_slab(start.x, motion.x, box.min.x, box.max.x, &enter, &exit) &&
+      sweep_slab(start.y, motion.y, box.min.y, box.max.y, &enter, &exit) &&
+      enter > 0.0) {
+    return enter;
+  }
+  return INFINITY;
+}
+
+// the region inside an ellipse with the given radii
+double sweep_ellipse(vector_t start, vector_t motion, vector_t center,
+                     double x_radius, double y_radius) {
+  // scaled so the ellipse is the unit circle
+  vector_t from = (vector_t){.x = (start.x - center.x) / x_radius,
+                             .y = (start.y - center.y) / y_radius};
+  vector_t step =
+      (vector_t){.x = motion.x / x_radius, .y = motion.y / y_radius};
+  double a = vec_dot(step, step);
+  double b = 2 * vec_dot(from, step);
+  double c = vec_dot(from, from) - 1;
+  double discriminant = (b * b) - (4 * a * c);
+  if (c <= 0 || a == 0 || discriminant < 0) {
+    return INFINITY;
+  }
+  double t = (-b - sqrt(discriminant)) / (2 * a);
+  return t > 0.0 && t <= 1.0 ? t : INFINITY;
+}
+
+// the region within radius of a box: the box grown sideways, the box grown
+// up and down, and a circle on each corner
+double sweep_rounded_box(vector_t start, vector_t motion, aabb_t box,
+                         double radius) {
+  vector_t nearest = (vector_t){.x = fmax(box.min.x, fmin(start.x, box.max.x)),
+                                .y = fmax(box.min.y, fmin(start.y, box.max.y))};
+  vector_t offset = vec_subtract(start, nearest);
+  if (vec_dot(offset, offset) <= radius * radius) {
+    return INFINITY;
+  }
+  aabb_t wide = {.min = {.x = box.min.x - radius, .y = box.min.y},
+                 .max = {.x = box.max.x + radius, .y = box.max.y}};
+  aabb_t tall = {.min = {.x = box.min.x, .y = box.min.y - radius},
+                 .max = {.x = box.max.x, .y = box.max.y + radius}};
+  double t = fmin(sweep_box(start, motion, wide),
+                  sweep_box(start, motion, tall));
+  vector_t corners[] = {box.min, box.max, {.x = box.min.x, .y = box.max.y},
+                        {.x = box.max.x, .y = box.min.y}};
+  for (size_t i = 0; i < 4; i++) {
+    t = fmin(t, sweep_ellipse(start, motion, corners[i], radius, radius));
+  }
+  return t;
+}
+
+// what a body is tested as in the narrow phase. circles, boxes and ellipses
+// have closed-form tests against each other, and anything else falls back to
+// the separating axis test on its vertices
+typedef enum {
+  SHAPE_CIRCLE,
+  SHAPE_AABB,
+  SHAPE_ELLIPSE,
+  SHAPE_POLYGON
+} shape_kind_t;
+
+typedef struct collision_shape {
+  shape_kind_t kind;
+  vector_t center;
+  vector_t radii;       // radii of a circle or ellipse, half the size of a box
+  shape_view_t polygon; // the vertices, for the separating axis test
+} collision_shape_t;
+
+// weapons with as many sides as a circle are tested as the circle around
+// them, blocks as their bounds and the egg as the ellipse around it. each
+// of these holds the polygon it stands for, so no contact is missed, and the
+// library still settles the exact collision once the pair is made
+collision_shape_t body_collision_shape(body_table_t *table, size_t idx) {
+  body_info_t *info = body_get_info(table->bodies[idx]);
+  collision_shape_t shape = {.kind = SHAPE_POLYGON,
+                             .center = table->centroids[idx],
+                             .polygon = body_table_shape(table, idx)};
+  if (info->prototype != NULL && info->prototype->sides >= CIRCLE_SIDES) {
+    double radius = info->prototype->bounding_radius * info->scale;
+    shape.kind = SHAPE_CIRCLE;
+    shape.radii = (vector_t){.x = radius, .y = radius};
+  } else if (table->roles[idx] == EGG) {
+    shape.kind = SHAPE_ELLIPSE;
+    shape.radii = (vector_t){.x = EGG_MAJOR_AXIS, .y = EGG_MINOR_AXIS};
+  } else if (is_block_role(table->roles[idx])) {
+    aabb_t bounds = shape_bounds(shape.polygon);
+    shape.kind = SHAPE_AABB;
+    shape.center = vec_multiply(0.5, vec_add(bounds.min, bounds.max));
+    shape.radii = vec_multiply(0.5, vec_subtract(bounds.max, bounds.min));
+  }
+  return shape;
+}
+
+// projects shape onto axis
+void shape_project(shape_view_t shape, vector_t axis, double *min,
+                   double *max) {
+  *min = INFINITY;
+  *max = -INFINITY;
+  for (size_t i = 0; i < shape.size; i++) {
+    double projection = vec_dot(shape.vertices[i], axis);
+    *min = fmin(*min, projection);
+    *max = fmax(*max, projection);
+  }
+}
+
+// true if no edge normal of edges separates it from other
+bool edges_overlap(shape_view_t edges, shape_view_t other) {
+  for (size_t i = 0; i < edges.size; i++) {
+    vector_t edge = vec_subtract(edges.vertices[(i + 1) % edges.size],
+                                 edges.vertices[i]);
+    vector_t axis = (vector_t){.x = -edge.y, .y = edge.x};
+    double min1, max1, min2, max2;
+    shape_project(edges, axis, &min1, &max1);
+    shape_project(other, axis, &min2, &max2);
+    if (max1 < min2 || max2 < min1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// separating axis test on two convex polygons
+bool polygons_overlap(shape_view_t shape1, shape_view_t shape2) {
+  return edges_overlap(shape1, shape2) && edges_overlap(shape2, shape1);
+}
+
+bool circle_aabb_overlap(collision_shape_t circle, collision_shape_t box) {
+  vector_t offset = vec_subtract(circle.center, box.center);
+  vector_t outside = (vector_t){.x = fmax(fabs(offset.x) - box.radii.x, 0),
+                                .y = fmax(fabs(offset.y) - box.radii.y, 0)};
+  return vec_dot(outside, outside) <= circle.radii.x * circle.radii.x;
+}
+
+// how much an ellipse with the given radii has to be scaled up to hold every
+// point within distance of it. the ellipse holds a circle of its smaller
+// radius, so scaling it by 1 + distance / that radius adds at least distance
+// all the way around. growing each radius by distance is not enough, since
+// the true outline bulges past that near the diagonals
+double ellipse_grow_scale(vector_t radii, double distance) {
+  return 1 + (distance / fmin(radii.x, radii.y));
+}
+
+// tests the circle's center against the ellipse scaled up to hold everything
+// within the circle's radius of it, so this can only err towards an overlap
+bool circle_ellipse_overlap(collision_shape_t circle,
+                            collision_shape_t ellipse) {
+  vector_t offset = vec_subtract(circle.center, ellipse.center);
+  double scale = ellipse_grow_scale(ellipse.radii, circle.radii.x);
+  vector_t scaled = (vector_t){.x = offset.x / (ellipse.radii.x * scale),
+                               .y = offset.y / (ellipse.radii.y * scale)};
+  return vec_dot(scaled, scaled) <= 1;
+}
+
+// picks the test for the pair's kinds
+bool shapes_overlap(collision_shape_t shape1, collision_shape_t shape2) {
+  if (shape1.kind > shape2.kind) {
+    collision_shape_t swap = shape1;
+    shape1 = shape2;
+    shape2 = swap;
+  }
+  vector_t offset = vec_subtract(shape1.center, shape2.center);
+  if (shape1.kind == SHAPE_CIRCLE) {
+    switch (shape2.kind) {
+    case SHAPE_CIRCLE: {
+      double reach = shape1.radii.x + shape2.radii.x;
+      return vec_dot(offset, offset) <= reach * reach;
+    }
+    case SHAPE_AABB:
+      return circle_aabb_overlap(shape1, shape2);
+    case SHAPE_ELLIPSE:
+      return circle_ellipse_overlap(shape1, shape2);
+    default:
+      break;
+    }
+  } else if (shape1.kind == SHAPE_AABB && shape2.kind == SHAPE_AABB) {
+    return fabs(offset.x) <= shape1.radii.x + shape2.radii.x &&
+           fabs(offset.y) <= shape1.radii.y + shape2.radii.y;
+  }
+  return polygons_overlap(shape1.polygon, shape2.polygon);
+}
+
+// called once for every new pair the broad phase finds
+typedef void (*contact_handler_t)(state_t *state, body_t *body1,
+                                  body_t *body2);
+
+void register_block_collision(state_t *state, body_t *weapon, body_t *block) {
+  create_block_collision(state->scene, block, weapon);
+}
+
+// which handler runs for a pair of roles
+typedef struct contact_rule {
+  role_t role1;
+  role_t role2;
+  contact_handler_t handler;
+} contact_rule_t;
+
+const contact_rule_t CONTACT_RULES[] = {
+    {WEAPON, HAY, register_block_collision},
+    {WEAPON, WOOD, register_block_collision},
+    {WEAPON, STEEL, register_block_collision},
+    {WEAPON, DIAMOND, register_block_collision},
+    {WEAPON, EGG, register_block_collision}};
+const size_t NUM_CONTACT_RULES =
+    sizeof(CONTACT_RULES) / sizeof(CONTACT_RULES[0]);
+
+contact_handler_t find_contact_handler(role_t role1, role_t role2) {
+  for (size_t i = 0; i < NUM_CONTACT_RULES; i++) {
+    if (CONTACT_RULES[i].role1 == role1 && CONTACT_RULES[i].role2 == role2) {
+      return CONTACT_RULES[i].handler;
+    }
+  }
+  return NULL;
+}
+
+// keeps fast weapons from passing through blocks and the egg between two
+// ticks. each weapon's inscribed circle is swept from where it was before the
+// last scene_tick to where it is now, and a weapon that hit something on the
+// way is moved back to where it first touched, plus SWEEP_DEPTH. it then
+// overlaps what it hit, so the broad phase pairs the two and the collision
+// is resolved on the next tick. a weapon that moved less than its inscribed
+// radius overlapped anything in its way at one end of the step, so it is
+// left to the discrete test. the egg is taken as its ellipse scaled up to
+// hold everything within the radius of it, like in the narrow phase
+void sweep_weapons(state_t *state) {
+  body_table_t *table = state->bodies;
+  role_set_t *weapons = body_table_role(table, WEAPON);
+  for (size_t i = 0; i < weapons->size; i++) {
+    size_t idx = weapons->indices[i];
+    body_info_t *info = body_get_info(table->bodies[idx]);
+    if (table->asleep[idx] || info->prototype == NULL) {
+      continue;
+    }
+    double radius = info->prototype->bounding_radius * info->scale *
+                    cos(PI / info->prototype->sides);
+    vector_t start = table->last_centroids[idx];
+    vector_t motion = vec_subtract(table->centroids[idx], start);
+    double distance = sqrt(vec_dot(motion, motion));
+    if (distance <= radius) {
+      continue;
+    }
+
+    vector_t extent = (vector_t){.x = radius, .y = radius};
+    aabb_t swept = {
+        .min = vec_subtract((vector_t){.x = fmin(start.x, start.x + motion.x),
+                                       .y = fmin(start.y, start.y + motion.y)},
+                            extent),
+        .max = vec_add((vector_t){.x = fmax(start.x, start.x + motion.x),
+                                  .y = fmax(start.y, start.y + motion.y)},
+                       extent)};
+    size_t min_row, max_row, min_col, max_col;
+    if (grid_range(swept, &min_row, &max_row, &min_col, &max_col) == false) {
+      continue;
+    }
+    double hit = INFINITY;
+    bool egg_swept = false;
+    for (size_t row = min_row; row <= max_row; row++) {
+      for (size_t col = min_col; col <= max_col; col++) {
+        grid_cell_t *cell = &state->grid[(row * NUM_GRID_COLS) + col];
+        if (cell->occupied == false ||
+            find_contact_handler(WEAPON, cell->material) == NULL) {
+          continue;
+        }
+        if (cell->material != EGG) {
+          hit = fmin(hit, sweep_rounded_box(start, motion,
+                                            block_bounds(row, col), radius));
+        } else if (egg_swept == false) {
+          // the egg can be knocked about, so it is swept where it is now
+          size_t egg;
+          if (body_table_find(table, cell->block, &egg)) {
+            vector_t radii = {.x = EGG_MAJOR_AXIS, .y = EGG_MINOR_AXIS};
+            double scale = ellipse_grow_scale(radii, radius);
+            hit = fmin(hit, sweep_ellipse(start, motion, table->centroids[egg],
+                                          radii.x * scale, radii.y * scale));
+          }
+          egg_swept = true;
+        }
+      }
+    }
+    if (hit != INFINITY) {
+      // never past where the weapon got to this tick
+      double t = fmin(1.0, hit + (SWEEP_DEPTH / distance));
+      vector_t centroid = vec_add(start, vec_multiply(t, motion));
+      body_set_centroid(table->bodies[idx], centroid);
+      table->centroids[idx] = centroid;
+    }
+  }
+}
+
+// contacts are kept as handles, so a body that takes the place of one that
+// was paired with body before is never mistaken for it
+bool has_contact(body_t *body, body_handle_t other) {
+  body_info_t *info = body_get_info(body);
+  for (size_t i = 0; i < info->num_contacts; i++) {
+    if (body_handle_equal(info->contacts[i], other)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// records that body has been paired with other. returns false if it already
+// had been
+bool add_contact(body_t *body, body_handle_t other) {
+  if (has_contact(body, other)) {
+    return false;
+  }
+  body_info_t *info = body_get_info(body);
+  if (info->num_contacts == info->contacts_capacity) {
+    size_t old_capacity = info->contacts_capacity;
+    info->contacts_capacity = old_capacity == 0 ? 4 : old_capacity * 2;
+    info->contacts = realloc(info->contacts,
+                             info->contacts_capacity * sizeof(body_handle_t));
+    assert(info->contacts != NULL);
+    alloc_stats_resize(info->stats, ALLOC_ROLE_INFO,
+                       old_capacity * sizeof(body_handle_t),
+                       info->contacts_capacity * sizeof(body_handle_t));
+  }
+  info->contacts[info->num_contacts] = other;
+  info->num_contacts++;
+  return true;
+}
+
+// bodies one weapon could touch soon that it hasn't been paired with yet
+typedef struct candidate_list {
+  body_handle_t *bodies;
+  size_t size;
+  size_t capacity;
+} candidate_list_t;
+
+void candidate_list_add(candidate_list_t *list, body_handle_t body) {
+  if (list->size == list->capacity) {
+    list->capacity = list->capacity == 0 ? 4 : list->capacity * 2;
+    list->bodies =
+        realloc(list->bodies, list->capacity * sizeof(body_handle_t));
+    assert(list->bodies != NULL);
+  }
+  list->bodies[list->size] = body;
+  list->size++;
+}
+
+typedef struct broad_phase_job {
+  state_t *state;
+  role_set_t *weapons;
+} broad_phase_job_t;
+
+// fills in the candidates of the weapons in [begin, end). this only reads the
+// world, and each weapon writes to its own list, so weapons can be gathered
+// on any thread
+void broad_phase_gather(void *aux, size_t begin, size_t end) {
+  broad_phase_job_t *job = aux;
+  state_t *state = job->state;
+  body_table_t *table = state->bodies;
+  for (size_t i = begin; i < end; i++) {
+    size_t idx = job->weapons->indices[i];
+    candidate_list_t *candidates = &state->candidates[i];
+    candidates->size = 0;
+    if (table->asleep[idx]) {
+      continue;
+    }
+    size_t min_row, max_row, min_col, max_col;
+    if (grid_range(body_bounds(table, idx), &min_row, &max_row, &min_col,
+                   &max_col) == false) {
+      continue;
+    }
+    collision_shape_t shape = body_collision_shape(table, idx);
+    for (size_t row = min_row; row <= max_row; row++) {
+      for (size_t col = min_col; col <= max_col; col++) {
+        grid_cell_t *cell = &state->grid[(row * NUM_GRID_COLS) + col];
+        size_t other;
+        if (cell->occupied &&
+            find_contact_handler(WEAPON, cell->material) != NULL &&
+            has_contact(table->bodies[idx], cell->block) == false &&
+            body_table_find(table, cell->block, &other) &&
+            shapes_overlap(shape, body_collision_shape(table, other))) {
+          candidate_list_add(candidates, cell->block);
+        }
+      }
+    }
+  }
+}
+
+// finds what each weapon touches and hands every new pair to the handler for
+// its roles. only blocks and the egg can be hit and they all sit on the
+// building grid, so the grid squares are the spatial hash: a weapon only
+// looks at the squares under its bounds, and only pairs with what its shape
+// overlaps there. a weapon is paired with a body once, when they first touch,
+// so the library's collision test only runs on pairs that really meet. fast
+// weapons can't skip past a body, since sweep_weapons stops them on it first.
+// the candidates are gathered on the job pool, then registered on this thread
+// in weapon and square order, so the pairs come out the same for any number
+// of threads
+void broad_phase(state_t *state) {
+  body_table_t *table = state->bodies;
+  role_set_t *weapons = body_table_role(table, WEAPON);
+  if (weapons->size > state->candidates_capacity) {
+    size_t capacity = weapons->size * 2;
+    state->candidates =
+        realloc(state->candidates, capacity * sizeof(candidate_list_t));
+    assert(state->candidates != NULL);
+    for (size_t i = state->candidates_capacity; i < capacity; i++) {
+      state->candidates[i] = (candidate_list_t){.bodies = NULL};
+    }
+    state->candidates_capacity = capacity;
+  }
 
-      break;
-    case MOUSE_MOVED:
-      if (state->game_over == false) {
-        hover_square(state, corrected_loc(loc));
+  broad_phase_job_t job = {.state = state, .weapons = weapons};
+  job_pool_run(state->jobs, weapons->size, BROAD_PHASE_GRAIN,
+               broad_phase_gather, &job);
+
+  for (size_t i = 0; i < weapons->size; i++) {
+    body_t *weapon = table->bodies[weapons->indices[i]];
+    candidate_list_t *candidates = &state->candidates[i];
+    for (size_t j = 0; j < candidates->size; j++) {
+      // a stale handle means the body went away after it was gathered
+      body_t *other = body_table_get(table, candidates->bodies[j]);
+      if (other != NULL && add_contact(weapon, candidates->bodies[j])) {
+        body_info_t *info = body_get_info(other);
+        find_contact_handler(WEAPON, info->role)(state, weapon, other);
+        state->contact_pairs++;
       }
-      break;
-    case P_KEY:
-      p_key_behavior(state);
-      break;
-    case ONE:
-      state->block_selected = HAY;
-      break;
-    case TWO:
-      state->block_selected = WOOD;
-      break;
-    case THREE:
-      state->block_selected = STEEL;
-      break;
-    case FOUR:
-      state->block_selected = DIAMOND;
-      break;
     }
   }
 }
 
-state_t *emscripten_init() {
-  srand(time(NULL));
-  sdl_on_key(on_key);
-
-  vector_t min = (vector_t){.x = 0, .y = 0};
-  vector_t max = WINDOW;
-  sdl_init(min, max);
+// swaps the job pool for one with the given number of threads
+void game_set_threads(state_t *state, size_t num_threads) {
+  job_pool_free(state->jobs);
+  state->jobs = job_pool_init(num_threads);
+}
 
+// builds the game state and world without touching SDL, so the same setup can
+// drive both the browser build and the headless driver
+state_t *game_init() {
   // assertions to ensure expected behavior of game
   assert(EGG_GRID_WIDTH > 0);
   assert(EGG_GRID_HEIGHT > 0);
@@ -863,25 +3759,47 @@ state_t *emscripten_init() {
 
   state_t *state = malloc(sizeof(state_t));
   state->scene = scene_init();
+  state->bodies = body_table_init(INITIAL_NUM_BODIES);
+  state->scenery = body_table_init(INITIAL_NUM_BODIES);
+  state->jobs = job_pool_init(DEFAULT_NUM_THREADS);
+  state->candidates = NULL;
+  state->candidates_capacity = 0;
+  state->ticks = 0;
+  state->tick_time = 0.0;
+  state->recording = (recording_t){.events = NULL};
+  state->profiler = NULL;
+  state->alloc_stats = alloc_stats_init();
+  game_seed(state, 0);
+  state->force_fields = force_fields_init(state->bodies);
+  force_fields_add(state->force_fields, (vector_t){.x = 0, .y = GRAVITY},
+                   role_bit(WEAPON));
+  scene_add_force_creator(state->scene, apply_force_fields, state->force_fields,
+                          force_fields_free);
   state->game_state = BUILDING;
   state->last_weapon_time = 0.0;
   state->total_time_elapsed = 0.0;
   state->block_selected = HAY;
-  state->weapon_queue = list_init(1, free);
+  state->text = NULL;
+  state->weapon_queue = weapon_queue_init(INITIAL_WEAPON_QUEUE);
   state->level = STARTING_LEVEL;
   state->credits = calc_credits(STARTING_LEVEL);
   state->egg_health = EGG_HEALTH;
   state->game_over = false;
   state->is_paused = true;
-
-  TTF_Font *font = TTF_OpenFont("assets/digital.ttf", MENU_TEXT_SIZE);
-  text_t *text = text_init(font, free);
-  state->text = text;
-
-  TTF_Font *game_over_font =
-      TTF_OpenFont("assets/digital.ttf", GAME_OVER_TEXT_SIZE);
-  text_t *new_text = text_init(game_over_font, free);
-  state->game_over_text = new_text;
+  state->game_over_text = NULL;
+  state->contact_pairs = 0;
+  state->ui = ui_init();
+  state->building_layer = NULL;
+  state->shooting_layer = NULL;
+  state->layer_width = 0;
+  state->layer_height = 0;
+  state->batch = NULL;
+  state->hud = NULL;
+  state->memory = body_memory_init(state->alloc_stats);
+  state->prototypes = list_init(3, shape_prototype_free);
+  shape_prototype_get(state->prototypes, CIRCLE_SIDES);
+  shape_prototype_get(state->prototypes, TRIANGLE_SIDES);
+  shape_prototype_get(state->prototypes, SQUARE_SIDES);
 
   // add costs that will be displayed in the game
   size_t *ptr1 = malloc(sizeof(size_t));
@@ -899,61 +3817,45 @@ state_t *emscripten_init() {
   list_add(state->costs, ptr3);
   list_add(state->costs, ptr4);
 
-  // add grid spots that the egg takes up
-  state->egg_grid_spots_x = list_init(EGG_GRID_WIDTH, free);
-  state->egg_grid_spots_y = list_init(EGG_GRID_HEIGHT, free);
-
-  size_t *first_x = malloc(sizeof(size_t));
-  *first_x = EGG_BOTTOM_LEFT_GRID_COL;
-  list_add(state->egg_grid_spots_x, first_x);
-  for (size_t i = 1; i < EGG_GRID_WIDTH; i++) {
-    size_t *new_x = malloc(sizeof(size_t));
-    *new_x = *first_x + i;
-    list_add(state->egg_grid_spots_x, new_x);
-  }
-  size_t *first_y = malloc(sizeof(size_t));
-  *first_y = EGG_BOTTOM_LEFT_GRID_ROW;
-  list_add(state->egg_grid_spots_y, first_y);
-  for (size_t i = 1; i < EGG_GRID_HEIGHT; i++) {
-    size_t *new_y = malloc(sizeof(size_t));
-    *new_y = *first_y + i;
-    list_add(state->egg_grid_spots_y, new_y);
-  }
-
-  create_background(state->scene);
-  create_island(state->scene);
-  create_menu(state->scene);
-  create_egg(state->scene);
-  create_grid(state->scene);
+  state->grid = calloc(NUM_GRID_ROWS * NUM_GRID_COLS, sizeof(grid_cell_t));
+  assert(state->grid != NULL);
+
+  create_background(state);
+  create_island(state);
+  create_menu(state);
+  create_egg(state);
+  create_grid(state);
+  state->start = snapshot_capture(state);
 
   return state;
 }
 
-void emscripten_main(state_t *state) {
-  sdl_clear();
-
-  list_t *all_bodies = scene_get_all_bodies(state->scene);
+// advances the physics and game logic by dt seconds. nothing in here draws,
+// so it can run faster than the display
+void game_tick(state_t *state, double dt) {
+  body_table_t *table = state->bodies;
+  state->ticks++;
 
-  double dt = time_since_last_tick();
   state->last_weapon_time += dt;
   state->total_time_elapsed += dt;
 
+  profiler_t *profiler = state->profiler;
+  body_table_flush(table, state->grid);
   if (state->is_paused == false || state->game_state == BUILDING) {
+    double start = profile_begin(profiler);
     scene_tick(state->scene, dt);
-
-    // apply gravity to the weapons
-    for (size_t i = 0; i < list_size(all_bodies); i++) {
-      body_t *curr_body = list_get(all_bodies, i);
-      if (*(size_t *)body_get_info(curr_body) == WEAPON) {
-        vector_t og_vel = body_get_velocity(curr_body);
-        body_set_velocity(
-            curr_body,
-            (vector_t){.x = og_vel.x, .y = og_vel.y + (GRAVITY * dt)});
-      }
-    }
+    profile_end(profiler, PHASE_SCENE_TICK, start);
+    start = profile_begin(profiler);
+    body_table_sync(table, state->scene, state->grid);
+    body_table_update_sleep(table, dt);
+    profile_end(profiler, PHASE_SYNC, start);
+    start = profile_begin(profiler);
+    sweep_weapons(state);
+    broad_phase(state);
+    profile_end(profiler, PHASE_COLLISION, start);
   }
 
-  if (state->game_state == SHOOTING && list_size(state->weapon_queue) == 0 &&
+  if (state->game_state == SHOOTING && state->weapon_queue->size == 0 &&
       state->last_weapon_time >= BUILDING_PHASE_DELAY &&
       state->game_over == false) {
     state->game_state = BUILDING;
@@ -963,56 +3865,323 @@ void emscripten_main(state_t *state) {
   }
 
   if (state->last_weapon_time >= WEAPON_LAUNCH_TIME_INTERVAL &&
-      list_size(state->weapon_queue) > 0 && state->game_state == SHOOTING &&
+      state->weapon_queue->size > 0 && state->game_state == SHOOTING &&
       state->is_paused == false) {
     // spawn_weapon
-    body_t *curr_weapon = list_remove(state->weapon_queue, 0);
+    double start = profile_begin(profiler);
+    body_t *curr_weapon =
+        create_weapon(state, weapon_queue_pop(state->weapon_queue));
     state->last_weapon_time = 0.0;
-    scene_add_body(state->scene, curr_weapon);
-
-    // create collisions between the block and the projectile created
-    for (size_t i = 0; i < list_size(all_bodies); i++) {
-      body_t *curr_body = list_get(all_bodies, i);
-      if (is_block(curr_body) || *(role_t *)body_get_info(curr_body) == EGG) {
-        create_block_collision(state->scene, curr_body, curr_weapon);
-      }
-    }
+    game_add_body(state, curr_weapon);
+    profile_end(profiler, PHASE_SPAWN, start);
   }
 
-  // draw all bodies
-  if (state->game_state == BUILDING) {
-    for (size_t i = 0; i < list_size(all_bodies); i++) {
-      body_t *curr_body = list_get(all_bodies, i);
-      list_t *curr_body_shape = body_get_shape(curr_body);
-      sdl_draw_polygon(curr_body_shape, body_get_color(curr_body));
-      list_free(curr_body_shape);
-    }
-  } else { // don't draw grid lines if not in building mode
-    for (size_t i = 0; i < list_size(all_bodies); i++) {
-      body_t *curr_body = list_get(all_bodies, i);
-      if (*(role_t *)body_get_info(curr_body) != GRID_LINE) {
-        list_t *curr_body_shape = body_get_shape(curr_body);
-        sdl_draw_polygon(curr_body_shape, body_get_color(curr_body));
-        list_free(curr_body_shape);
-      }
-    }
-  }
-
-  selected_block_circle(state);
-  draw_pause_play(state);
-
   if (state->game_over == false) {
+    double start = profile_begin(profiler);
     remove_weapons_out_of_bounds(state);
+    profile_end(profiler, PHASE_OUT_OF_BOUNDS, start);
   }
 
   // check and update stats based on the egg
-  body_t *egg = get_egg(state->scene);
+  body_t *egg = get_egg(state);
   if (body_get_health(egg) <= 0.0) {
     set_game_over(state);
     body_set_health(egg, 0.0);
     body_set_color(egg, BLACK);
   }
   state->egg_health = body_get_health(egg);
+}
+
+#ifndef HEADLESS
+// draws the static bodies into a new texture the size of the window
+SDL_Texture *render_static_layer(state_t *state, SDL_Renderer *renderer,
+                                 bool with_grid) {
+  SDL_Texture *layer =
+      SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+                        SDL_TEXTUREACCESS_TARGET, state->layer_width,
+                        state->layer_height);
+  if (layer == NULL || SDL_SetRenderTarget(renderer, layer) != 0) {
+    if (layer != NULL) {
+      SDL_DestroyTexture(layer);
+    }
+    return NULL;
+  }
+  sdl_clear();
+  body_table_t *table = state->scenery;
+  if (state->batch != NULL) {
+    draw_batch_begin(state->batch);
+  }
+  for (size_t i = 0; i < table->size; i++) {
+    if (with_grid || table->roles[i] != GRID_LINE) {
+      draw_polygon(state, body_table_shape(table, i),
+                   body_get_color(table->bodies[i]));
+    }
+  }
+  if (state->batch != NULL) {
+    draw_batch_flush(state->batch, renderer);
+  }
+  SDL_SetRenderTarget(renderer, NULL);
+  return layer;
+}
+
+void free_static_layers(state_t *state) {
+  if (state->building_layer != NULL) {
+    SDL_DestroyTexture(state->building_layer);
+    state->building_layer = NULL;
+  }
+  if (state->shooting_layer != NULL) {
+    SDL_DestroyTexture(state->shooting_layer);
+    state->shooting_layer = NULL;
+  }
+}
+
+// blits the static layer for the current phase, rendering both layers first
+// if they haven't been yet or the window changed size. returns false if the
+// layers can't be rendered, in which case the static bodies have to be drawn
+// one by one
+bool draw_static_layer(state_t *state) {
+  SDL_Renderer *renderer = get_renderer();
+  if (renderer == NULL) {
+    return false;
+  }
+  int width, height;
+  SDL_GetWindowSize(get_window(), &width, &height);
+  if (width != state->layer_width || height != state->layer_height ||
+      state->building_layer == NULL || state->shooting_layer == NULL) {
+    free_static_layers(state);
+    state->layer_width = width;
+    state->layer_height = height;
+    state->building_layer = render_static_layer(state, renderer, true);
+    state->shooting_layer = render_static_layer(state, renderer, false);
+    if (state->building_layer == NULL || state->shooting_layer == NULL) {
+      free_static_layers(state);
+      return false;
+    }
+  }
+  SDL_Texture *layer = state->game_state == BUILDING ? state->building_layer
+                                                     : state->shooting_layer;
+  SDL_RenderCopy(renderer, layer, NULL, NULL);
+  return true;
+}
+
+// a piece of hud text. its texture is only rendered again when the value it
+// shows changes
+typedef struct text_label {
+  SDL_Texture *texture;
+  int width;
+  int height;
+  size_t value;
+} text_label_t;
+
+typedef struct hud {
+  TTF_Font *font;
+  TTF_Font *game_over_font;
+  text_label_t level;
+  text_label_t credits;
+  text_label_t health;
+  text_label_t *costs; // one per block selection
+  text_label_t game_over;
+  alloc_stats_t *stats;
+} hud_t;
+
+hud_t *hud_init(alloc_stats_t *stats) {
+  TTF_Font *font = TTF_OpenFont(FONT_PATH, MENU_TEXT_SIZE);
+  TTF_Font *game_over_font = TTF_OpenFont(FONT_PATH, GAME_OVER_TEXT_SIZE);
+  if (font == NULL || game_over_font == NULL) {
+    if (font != NULL) {
+      TTF_CloseFont(font);
+    }
+    if (game_over_font != NULL) {
+      TTF_CloseFont(game_over_font);
+    }
+    return NULL;
+  }
+  hud_t *hud = calloc(1, sizeof(hud_t));
+  assert(hud != NULL);
+  hud->font = font;
+  hud->game_over_font = game_over_font;
+  hud->costs = calloc(NUM_OF_SELECTIONS, sizeof(text_label_t));
+  assert(hud->costs != NULL);
+  hud->stats = stats;
+  return hud;
+}
+
+void text_label_clear(alloc_stats_t *stats, text_label_t *label) {
+  if (label->texture != NULL) {
+    alloc_stats_remove(stats, ALLOC_TEXT, label->width * label->height * 4);
+    SDL_DestroyTexture(label->texture);
+    label->texture = NULL;
+  }
+}
+
+void hud_free(hud_t *hud) {
+  text_label_clear(hud->stats, &hud->level);
+  text_label_clear(hud->stats, &hud->credits);
+  text_label_clear(hud->stats, &hud->health);
+  text_label_clear(hud->stats, &hud->game_over);
+  for (size_t i = 0; i < NUM_OF_SELECTIONS; i++) {
+    text_label_clear(hud->stats, &hud->costs[i]);
+  }
+  free(hud->costs);
+  TTF_CloseFont(hud->font);
+  TTF_CloseFont(hud->game_over_font);
+  free(hud);
+}
+
+// draws a label showing value through format, rasterizing it only when value
+// differs from what its texture shows. loc is the left end of the label's
+// baseline, or its center if centered is true
+void draw_label(state_t *state, SDL_Renderer *renderer, TTF_Font *font,
+                text_label_t *label, const char *format, size_t value,
+                vector_t loc, bool centered) {
+  if (label->texture == NULL || label->value != value) {
+    text_label_clear(state->alloc_stats, label);
+    char text[MAX_LABEL_LENGTH];
+    snprintf(text, MAX_LABEL_LENGTH, format, value);
+    SDL_Surface *surface = TTF_RenderText_Blended(font, text, BLACK_SDL);
+    if (surface == NULL) {
+      return;
+    }
+    label->texture = SDL_CreateTextureFromSurface(renderer, surface);
+    label->width = surface->w;
+    label->height = surface->h;
+    label->value = value;
+    SDL_FreeSurface(surface);
+    if (label->texture == NULL) {
+      return;
+    }
+    alloc_stats_add(state->alloc_stats, ALLOC_TEXT,
+                    label->width * label->height * 4);
+  }
+  double scale = state->batch->scale;
+  vector_t position = window_position(state->batch, loc);
+  SDL_Rect dest = {.x = position.x,
+                   .y = position.y - (label->height * scale),
+                   .w = label->width * scale,
+                   .h = label->height * scale};
+  if (centered) {
+    dest.x -= dest.w / 2;
+    dest.y += dest.h / 2;
+  }
+  SDL_RenderCopy(renderer, label->texture, NULL, &dest);
+}
+
+// draws the level, credits, health, block costs and game over message
+void draw_hud(state_t *state, SDL_Renderer *renderer) {
+  hud_t *hud = state->hud;
+  draw_label(state, renderer, hud->font, &hud->level, LEVEL_LABEL_FORMAT,
+             state->level, LEVEL_LABEL_LOC, false);
+  draw_label(state, renderer, hud->font, &hud->credits, CREDITS_LABEL_FORMAT,
+             state->credits, CREDITS_LABEL_LOC, false);
+  draw_label(state, renderer, hud->font, &hud->health, HEALTH_LABEL_FORMAT,
+             round(state->egg_health), HEALTH_LABEL_LOC, false);
+
+  vector_t cost_loc = (vector_t){
+      .x = ((WINDOW.x - MENU_WIDTH + SELECTION_SEPARATION) +
+            (WINDOW.x - (MENU_WIDTH / 2) - (MENU_BLOCK_DIM / 2))) /
+           2,
+      .y = WINDOW.y - SELECTION_SEPARATION - (SELECTION_HEIGHT / 2)};
+  for (size_t i = 0; i < NUM_OF_SELECTIONS; i++) {
+    draw_label(state, renderer, hud->font, &hud->costs[i], COST_LABEL_FORMAT,
+               *(size_t *)list_get(state->costs, i), cost_loc, true);
+    cost_loc.y -= SELECTION_HEIGHT + SELECTION_SEPARATION;
+  }
+
+  if (state->game_over) {
+    draw_label(state, renderer, hud->game_over_font, &hud->game_over,
+               GAME_OVER_MSG, 0,
+               (vector_t){.x = EGG_CENTROID.x, .y = GAME_OVER_MSG_Y}, true);
+  }
+}
+
+state_t *emscripten_init() {
+  sdl_on_key(on_key);
+
+  vector_t min = (vector_t){.x = 0, .y = 0};
+  vector_t max = WINDOW;
+  sdl_init(min, max);
+
+  state_t *state = game_init();
+  game_seed(state, time(NULL));
+  state->profiler = profiler_init(PROFILE_CAPACITY);
+  if (get_renderer() != NULL) {
+    state->batch = draw_batch_init();
+  }
+
+  // the hud draws through the batch's mapping, so it needs a renderer too
+  if (state->batch != NULL) {
+    state->hud = hud_init(state->alloc_stats);
+  }
+  if (state->hud == NULL) {
+    TTF_Font *font = TTF_OpenFont(FONT_PATH, MENU_TEXT_SIZE);
+    text_t *text = text_init(font, free);
+    state->text = text;
+
+    TTF_Font *game_over_font = TTF_OpenFont(FONT_PATH, GAME_OVER_TEXT_SIZE);
+    text_t *new_text = text_init(game_over_font, free);
+    state->game_over_text = new_text;
+  }
+
+  return state;
+}
+
+void emscripten_main(state_t *state) {
+  sdl_clear();
+
+  // the game always steps by FIXED_DT, so a recorded session replays the same
+  // way no matter how fast it is drawn
+  state->tick_time += fmin(time_since_last_tick(), MAX_FRAME_TIME);
+  while (state->tick_time >= FIXED_DT) {
+    game_tick(state, FIXED_DT);
+    state->tick_time -= FIXED_DT;
+  }
+
+  // draw all bodies. the scenery comes from the cached layer when there is
+  // one, and grid lines are only drawn in building mode
+  profiler_t *profiler = state->profiler;
+  double start = profile_begin(profiler);
+  bool layer_drawn = draw_static_layer(state);
+  if (state->batch != NULL) {
+    draw_batch_begin(state->batch);
+  }
+  body_table_t *scenery = state->scenery;
+  for (size_t i = 0; i < scenery->size && layer_drawn == false; i++) {
+    if (state->game_state == BUILDING || scenery->roles[i] != GRID_LINE) {
+      draw_polygon(state, body_table_shape(scenery, i),
+                   body_get_color(scenery->bodies[i]));
+    }
+  }
+  body_table_t *table = state->bodies;
+  for (size_t i = 0; i < table->size; i++) {
+    draw_polygon(state, body_table_shape(table, i),
+                 body_get_color(table->bodies[i]));
+  }
+  profile_end(profiler, PHASE_DRAW, start);
+
+  start = profile_begin(profiler);
+  draw_hover_square(state);
+  selected_block_circle(state);
+  draw_pause_play(state);
+  if (SHOW_PROFILE_OVERLAY && profiler != NULL) {
+    draw_profile_overlay(state);
+  }
+  if (state->batch != NULL) {
+    draw_batch_flush(state->batch, get_renderer());
+  }
+  profile_end(profiler, PHASE_UI, start);
+
+  if (state->hud != NULL) {
+    start = profile_begin(profiler);
+    draw_hud(state, get_renderer());
+    profile_end(profiler, PHASE_TEXT, start);
+    start = profile_begin(profiler);
+    sdl_show();
+    profile_end(profiler, PHASE_SHOW, start);
+    profile_frame(profiler, table->size, state->contact_pairs);
+    return;
+  }
+
+  start = profile_begin(profiler);
 
   double spawn_loc_x = ((WINDOW.x - MENU_WIDTH + SELECTION_SEPARATION) +
                         (WINDOW.x - (MENU_WIDTH / 2) - (MENU_BLOCK_DIM / 2))) /
@@ -1024,12 +4193,620 @@ void emscripten_main(state_t *state) {
       state->game_over_text, state->game_over, GAME_OVER_MSG_Y, EGG_CENTROID,
       (vector_t){.x = spawn_loc_x, .y = spawn_loc_y},
       SELECTION_HEIGHT + SELECTION_SEPARATION, state->costs);
+  int msg_width = 0;
+  int msg_height = 0;
+  if (msg != NULL) {
+    SDL_QueryTexture(msg, NULL, NULL, &msg_width, &msg_height);
+    alloc_stats_add(state->alloc_stats, ALLOC_TEXT, msg_width * msg_height * 4);
+  }
+  profile_end(profiler, PHASE_TEXT, start);
+  start = profile_begin(profiler);
   sdl_show();
+  profile_end(profiler, PHASE_SHOW, start);
+  profile_frame(profiler, table->size, state->contact_pairs);
 
-  SDL_DestroyTexture(msg);
+  if (msg != NULL) {
+    alloc_stats_remove(state->alloc_stats, ALLOC_TEXT,
+                       msg_width * msg_height * 4);
+    SDL_DestroyTexture(msg);
+  }
 }
+#endif
 
 void emscripten_free(state_t *state) {
+#ifndef HEADLESS
+  // saving reads the world, so it has to happen before any of it is freed
+  if (state->recording.size > 0) {
+    recording_save(state, RECORDING_PATH);
+  }
+  if (state->profiler != NULL) {
+    profiler_save_trace(state->profiler, PROFILE_PATH);
+  }
+#endif
   scene_free(state->scene);
+  for (size_t i = 0; i < state->scenery->size; i++) {
+    body_free(state->scenery->bodies[i]);
+  }
+  body_table_free(state->scenery);
+  weapon_queue_free(state->weapon_queue);
+  body_memory_free(state->memory);
+  job_pool_free(state->jobs);
+  snapshot_free(state->start);
+  free(state->recording.events);
+  for (size_t i = 0; i < state->candidates_capacity; i++) {
+    free(state->candidates[i].bodies);
+  }
+  free(state->candidates);
+  list_free(state->prototypes);
+  body_table_free(state->bodies);
+  free(state->grid);
+  ui_free(state->ui);
+  list_free(state->costs);
+#ifndef HEADLESS
+  free_static_layers(state);
+  if (state->batch != NULL) {
+    draw_batch_free(state->batch);
+  }
+  if (state->hud != NULL) {
+    hud_free(state->hud);
+  }
+  if (state->text != NULL) {
+    text_free(state->text);
+  }
+  if (state->game_over_text != NULL) {
+    text_free(state->game_over_text);
+  }
+#endif
+  profiler_free(state->profiler);
+  alloc_stats_report_leaks(state->alloc_stats);
+  alloc_stats_free(state->alloc_stats);
   free(state);
 }
+
+#ifdef HEADLESS
+// headless driver: runs whole waves at a fixed timestep without SDL and reports
+// simulation throughput. build game.c with -DHEADLESS -pthread and link it
+// against the library without sdl_wrapper.c and emscripten.c
+// usage: ./game_headless [num_levels] [dt] [threads]
+//        ./game_headless scaling [num_levels] [dt]
+//        ./game_headless batch <layouts> [seeds] [level] [threads]
+//        ./game_headless replay <recording> [trace]
+//        ./game_headless memory [num_levels]
+//        ./game_headless kernels
+const size_t HEADLESS_NUM_LEVELS = 10;
+const double HEADLESS_DT = 1.0 / 60.0;
+const double HEADLESS_MAX_WAVE_TIME = 300.0; // stop a wave that never ends
+const unsigned int HEADLESS_SEED = 0;
+const size_t BATCH_SEEDS = 8;
+const size_t BATCH_LEVEL = 1;
+const size_t MAX_LAYOUT_LINE = 256;
+const size_t SCALING_THREADS[] = {1, 2, 4, 8};
+const size_t NUM_SCALING_THREADS =
+    sizeof(SCALING_THREADS) / sizeof(SCALING_THREADS[0]);
+const size_t KERNEL_BENCH_POINTS = 50000000; // points transformed per run
+const size_t KERNEL_BENCH_SIDES[] = {3, 4, 30, 60};
+const size_t NUM_KERNEL_BENCH_SIDES =
+    sizeof(KERNEL_BENCH_SIDES) / sizeof(KERNEL_BENCH_SIDES[0]);
+const size_t NARROW_PHASE_BENCH_PAIRS = 2000000; // pairs tested per run
+
+// returns the middle of the grid square at the given row and column
+vector_t grid_square_center(size_t row, size_t col) {
+  return (vector_t){
+      .x = GRID_BOTTOM_LEFT.x + ((col + 0.5) * GRID_SQUARE_WIDTH),
+      .y = GRID_BOTTOM_LEFT.y + ((row + 0.5) * GRID_SQUARE_HEIGHT)};
+}
+
+// spends the level's credits on hay walls wrapped around the egg, one layer at
+// a time, so that every wave has blocks to collide with
+void build_benchmark_fortress(state_t *state) {
+  state->block_selected = HAY;
+  for (size_t layer = 1; layer <= EGG_BOTTOM_LEFT_GRID_COL; layer++) {
+    size_t left_col = EGG_BOTTOM_LEFT_GRID_COL - layer;
+    size_t right_col = EGG_BOTTOM_LEFT_GRID_COL + EGG_GRID_WIDTH - 1 + layer;
+    size_t top_row = EGG_BOTTOM_LEFT_GRID_ROW + EGG_GRID_HEIGHT - 1 + layer;
+    if (right_col >= NUM_GRID_COLS || top_row >= NUM_GRID_ROWS) {
+      return;
+    }
+    for (size_t row = EGG_BOTTOM_LEFT_GRID_ROW; row <= top_row; row++) {
+      place_block(state, grid_square_center(row, left_col));
+    }
+    for (size_t col = left_col; col <= right_col; col++) {
+      place_block(state, grid_square_center(top_row, col));
+    }
+    if (state->credits <= HAY_COST) {
+      return;
+    }
+  }
+}
+
+// the per-vector_t path that transforms used to take: rotate, then translate,
+// then bound with fmin and fmax
+aabb_t transform_points_reference(const vector_t *points, size_t num_points,
+                                  double angle, vector_t offset,
+                                  vector_t *out) {
+  for (size_t i = 0; i < num_points; i++) {
+    out[i] = vec_add(vec_rotate(points[i], angle), offset);
+  }
+  aabb_t bounds = {.min = out[0], .max = out[0]};
+  for (size_t i = 1; i < num_points; i++) {
+    bounds.min.x = fmin(bounds.min.x, out[i].x);
+    bounds.min.y = fmin(bounds.min.y, out[i].y);
+    bounds.max.x = fmax(bounds.max.x, out[i].x);
+    bounds.max.y = fmax(bounds.max.y, out[i].y);
+  }
+  return bounds;
+}
+
+// times transforming and bounding the weapon and egg shapes with each path
+// and prints nanoseconds per shape
+void bench_kernels() {
+  printf("vertices,reference_ns,scalar_ns,simd_ns,speedup\n");
+  double sink = 0;
+  for (size_t i = 0; i < NUM_KERNEL_BENCH_SIDES; i++) {
+    size_t sides = KERNEL_BENCH_SIDES[i];
+    size_t runs = KERNEL_BENCH_POINTS / sides;
+    vector_t *points = ellipse_points(sides, 1, 1, VEC_ZERO);
+    vector_t *out = malloc(sides * sizeof(vector_t));
+    assert(out != NULL);
+
+    double start = wall_time();
+    for (size_t run = 0; run < runs; run++) {
+      double angle = run * 1e-3;
+      aabb_t bounds = transform_points_reference(
+          points, sides, angle, (vector_t){.x = run, .y = 0}, out);
+      sink += bounds.max.x;
+    }
+    double reference = wall_time() - start;
+
+    start = wall_time();
+    for (size_t run = 0; run < runs; run++) {
+      double angle = run * 1e-3;
+      vector_t rotation = (vector_t){.x = cos(angle), .y = sin(angle)};
+      aabb_t bounds = transform_points_scalar(
+          points, sides, rotation, (vector_t){.x = run, .y = 0}, out);
+      sink += bounds.max.x;
+    }
+    double scalar = wall_time() - start;
+
+    start = wall_time();
+    for (size_t run = 0; run < runs; run++) {
+      double angle = run * 1e-3;
+      vector_t rotation = (vector_t){.x = cos(angle), .y = sin(angle)};
+      aabb_t bounds = transform_points(points, sides, rotation,
+                                       (vector_t){.x = run, .y = 0}, out);
+      sink += bounds.max.x;
+    }
+    double simd = wall_time() - start;
+
+    printf("%zu,%.2f,%.2f,%.2f,%.2f\n", sides, reference * 1e9 / runs,
+           scalar * 1e9 / runs, simd * 1e9 / runs, reference / simd);
+    free(points);
+    free(out);
+  }
+  // keeps the loops from being optimized away
+  if (sink == 0) {
+    printf("\n");
+  }
+}
+
+// times a circle weapon against a block, as polygons with the separating axis
+// test and as a circle and a box with the closed-form test, and prints
+// nanoseconds per pair. the block slides past the circle so about half the
+// pairs touch
+void bench_narrow_phase() {
+  printf("pair,sat_ns,closed_form_ns,speedup\n");
+  vector_t *circle_points = ellipse_points(CIRCLE_SIDES, 10, 10, VEC_ZERO);
+  vector_t *box_points = rectangle_points(-20, 20, 40, 40);
+  collision_shape_t circle = {
+      .kind = SHAPE_CIRCLE,
+      .center = VEC_ZERO,
+      .radii = {.x = 10, .y = 10},
+      .polygon = {.vertices = circle_points, .size = CIRCLE_SIDES}};
+  collision_shape_t box = {
+      .kind = SHAPE_AABB,
+      .radii = {.x = 20, .y = 20},
+      .polygon = {.vertices = box_points, .size = BLOCK_VERTICES}};
+  size_t hits = 0;
+
+  double start = wall_time();
+  for (size_t run = 0; run < NARROW_PHASE_BENCH_PAIRS; run++) {
+    double x = (double)(run % 120) - 60;
+    rectangle_fill(box_points, x - 20, 20, 40, 40);
+    hits += polygons_overlap(circle.polygon, box.polygon);
+  }
+  double sat = wall_time() - start;
+
+  start = wall_time();
+  for (size_t run = 0; run < NARROW_PHASE_BENCH_PAIRS; run++) {
+    double x = (double)(run % 120) - 60;
+    rectangle_fill(box_points, x - 20, 20, 40, 40);
+    box.center = (vector_t){.x = x, .y = 0};
+    hits += shapes_overlap(circle, box);
+  }
+  double closed_form = wall_time() - start;
+
+  printf("circle_block,%.2f,%.2f,%.2f\n",
+         sat * 1e9 / NARROW_PHASE_BENCH_PAIRS,
+         closed_form * 1e9 / NARROW_PHASE_BENCH_PAIRS, sat / closed_form);
+  free(circle_points);
+  free(box_points);
+  // keeps the loops from being optimized away
+  if (hits == 0) {
+    printf("\n");
+  }
+}
+
+// plays up to num_levels waves from a fresh game on num_threads threads.
+// prints a row per wave if print_levels is set and returns the total ticks
+// and wall time
+void run_benchmark(size_t num_levels, double dt, size_t num_threads,
+                   bool print_levels, double *total_ticks,
+                   double *total_wall) {
+  state_t *state = game_init();
+  game_seed(state, HEADLESS_SEED);
+  game_set_threads(state, num_threads);
+
+  *total_ticks = 0;
+  *total_wall = 0;
+  for (size_t i = 0; i < num_levels && state->game_over == false; i++) {
+    size_t level = state->level;
+    build_benchmark_fortress(state);
+    p_key_behavior(state);
+
+    size_t ticks = 0;
+    double sim_time = 0.0;
+    double start = wall_time();
+    while (state->game_state == SHOOTING && state->game_over == false &&
+           sim_time < HEADLESS_MAX_WAVE_TIME) {
+      game_tick(state, dt);
+      sim_time += dt;
+      ticks++;
+    }
+    double elapsed = wall_time() - start;
+    *total_ticks += ticks;
+    *total_wall += elapsed;
+
+    if (print_levels) {
+      printf("%zu,%zu,%zu,%zu,%.3f,%.6f,%.1f\n", level, state->bodies->size,
+             state->contact_pairs, ticks, sim_time, elapsed, ticks / elapsed);
+    }
+  }
+  emscripten_free(state);
+}
+
+// plays levels like run_benchmark and prints what the game holds after each
+// one, to check that memory stays flat from level to level
+void run_memory(size_t num_levels) {
+  state_t *state = game_init();
+  game_seed(state, HEADLESS_SEED);
+
+  alloc_stats_print_csv_header(stdout);
+  alloc_stats_print_csv(state->alloc_stats, 0, stdout);
+  for (size_t i = 0; i < num_levels && state->game_over == false; i++) {
+    size_t level = state->level;
+    build_benchmark_fortress(state);
+    p_key_behavior(state);
+    double sim_time = 0.0;
+    while (state->game_state == SHOOTING && state->game_over == false &&
+           sim_time < HEADLESS_MAX_WAVE_TIME) {
+      game_tick(state, HEADLESS_DT);
+      sim_time += HEADLESS_DT;
+    }
+    alloc_stats_print_csv(state->alloc_stats, level, stdout);
+  }
+  emscripten_free(state);
+}
+
+// a fortress layout: the block material on each grid square, or EGG for
+// squares left empty. stored row by row from the bottom, like the grid
+typedef struct layout {
+  role_t *cells;
+} layout_t;
+
+void layout_free(void *layout) {
+  free(((layout_t *)layout)->cells);
+  free(layout);
+}
+
+// maps a layout character to a material. '.' and 'E' leave the square empty
+bool layout_material(char c, role_t *material) {
+  switch (c) {
+  case '.':
+  case 'E':
+    *material = EGG;
+    return true;
+  case 'H':
+    *material = HAY;
+    return true;
+  case 'W':
+    *material = WOOD;
+    return true;
+  case 'S':
+    *material = STEEL;
+    return true;
+  case 'D':
+    *material = DIAMOND;
+    return true;
+  default:
+    return false;
+  }
+}
+
+// reads layouts from a file. each layout is NUM_GRID_ROWS lines of
+// NUM_GRID_COLS characters, top row first. blank lines and lines starting
+// with '#' are skipped. returns NULL and prints why if the file is malformed
+list_t *read_layouts(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "can't open %s\n", path);
+    return NULL;
+  }
+  list_t *layouts = list_init(1, layout_free);
+  layout_t *layout = NULL;
+  size_t row = 0;
+  size_t line_number = 0;
+  char line[MAX_LAYOUT_LINE];
+  while (fgets(line, MAX_LAYOUT_LINE, file) != NULL) {
+    line_number++;
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0' || line[0] == '#') {
+      continue;
+    }
+    bool valid = strlen(line) == NUM_GRID_COLS;
+    if (layout == NULL) {
+      layout = malloc(sizeof(layout_t));
+      assert(layout != NULL);
+      layout->cells = malloc(NUM_GRID_ROWS * NUM_GRID_COLS * sizeof(role_t));
+      assert(layout->cells != NULL);
+      row = NUM_GRID_ROWS;
+    }
+    row--;
+    for (size_t col = 0; col < NUM_GRID_COLS && valid; col++) {
+      valid = layout_material(line[col],
+                              &layout->cells[(row * NUM_GRID_COLS) + col]);
+    }
+    if (valid == false) {
+      fprintf(stderr, "%s:%zu: expected %zu of '.', 'E', 'H', 'W', 'S', 'D'\n",
+              path, line_number, NUM_GRID_COLS);
+      layout_free(layout);
+      list_free(layouts);
+      fclose(file);
+      return NULL;
+    }
+    if (row == 0) {
+      list_add(layouts, layout);
+      layout = NULL;
+    }
+  }
+  fclose(file);
+  if (layout != NULL) {
+    fprintf(stderr, "%s: last layout has fewer than %zu rows\n", path,
+            NUM_GRID_ROWS);
+    layout_free(layout);
+    list_free(layouts);
+    return NULL;
+  }
+  return layouts;
+}
+
+// what happened in one wave against one layout
+typedef struct wave_result {
+  size_t cost;
+  size_t blocks;
+  size_t destroyed;
+  double egg_health;
+  double wave_time;
+  size_t ticks;
+} wave_result_t;
+
+// builds the layout in a fresh game, plays the given level's wave with the
+// given seed until it ends or the egg breaks, and reports the outcome
+wave_result_t evaluate_wave(layout_t *layout, uint64_t seed, size_t level,
+                            double dt) {
+  state_t *state = game_init();
+  game_seed(state, seed);
+  state->level = level;
+
+  wave_result_t result = {0};
+  for (size_t row = 0; row < NUM_GRID_ROWS; row++) {
+    for (size_t col = 0; col < NUM_GRID_COLS; col++) {
+      role_t material = layout->cells[(row * NUM_GRID_COLS) + col];
+      if (material == EGG ||
+          state->grid[(row * NUM_GRID_COLS) + col].occupied) {
+        continue;
+      }
+      add_block(state, row, col, material);
+      result.cost += get_block_kind(material).cost;
+      result.blocks++;
+    }
+  }
+
+  p_key_behavior(state);
+  while (state->game_state == SHOOTING && state->game_over == false &&
+         result.wave_time < HEADLESS_MAX_WAVE_TIME) {
+    game_tick(state, dt);
+    result.wave_time += dt;
+    result.ticks++;
+  }
+
+  size_t remaining = 0;
+  for (size_t i = 0; i < NUM_BLOCK_ROLES; i++) {
+    remaining += body_table_role(state->bodies, BLOCK_ROLES[i])->size;
+  }
+  result.destroyed = result.blocks - remaining;
+  result.egg_health = state->egg_health;
+  emscripten_free(state);
+  return result;
+}
+
+typedef struct batch_job {
+  list_t *layouts;
+  size_t num_seeds;
+  size_t level;
+  double dt;
+  wave_result_t *results; // one per layout and seed, seeds varying fastest
+} batch_job_t;
+
+void batch_run(void *aux, size_t begin, size_t end) {
+  batch_job_t *job = aux;
+  for (size_t run = begin; run < end; run++) {
+    layout_t *layout = list_get(job->layouts, run / job->num_seeds);
+    job->results[run] =
+        evaluate_wave(layout, run % job->num_seeds, job->level, job->dt);
+  }
+}
+
+// plays every layout against seeds 0 to num_seeds - 1 on all threads and
+// prints a row per run
+int run_batch(const char *path, size_t num_seeds, size_t level, double dt,
+              size_t num_threads) {
+  list_t *layouts = read_layouts(path);
+  if (layouts == NULL) {
+    return 1;
+  }
+  size_t num_runs = list_size(layouts) * num_seeds;
+  batch_job_t job = {.layouts = layouts,
+                     .num_seeds = num_seeds,
+                     .level = level,
+                     .dt = dt,
+                     .results = malloc(num_runs * sizeof(wave_result_t))};
+  assert(job.results != NULL);
+
+  // each game gets its own single-threaded pool, so this one only has to
+  // spread the runs
+  job_pool_t *pool = job_pool_init(num_threads);
+  double start = wall_time();
+  job_pool_run(pool, num_runs, 1, batch_run, &job);
+  double elapsed = wall_time() - start;
+  job_pool_free(pool);
+
+  printf("layout,seed,level,cost,credits,blocks,destroyed,egg_health,"
+         "wave_seconds,ticks\n");
+  for (size_t run = 0; run < num_runs; run++) {
+    wave_result_t *result = &job.results[run];
+    printf("%zu,%zu,%zu,%zu,%zu,%zu,%zu,%.1f,%.3f,%zu\n", run / num_seeds,
+           run % num_seeds, level, result->cost, calc_credits(level),
+           result->blocks, result->destroyed, result->egg_health,
+           result->wave_time, result->ticks);
+  }
+  fprintf(stderr, "%zu runs in %.3f s (%.0f runs per minute)\n", num_runs,
+          elapsed, num_runs * 60 / elapsed);
+
+  free(job.results);
+  list_free(layouts);
+  return 0;
+}
+
+// plays a recorded session again as fast as it will go and checks that it
+// ends exactly where the original did. every tick is profiled into a Chrome
+// trace at trace_path when it isn't NULL
+int run_replay(const char *path, const char *trace_path) {
+  recording_header_t header;
+  input_event_t *events;
+  if (recording_load(path, &header, &events) == false) {
+    fprintf(stderr, "can't read a recording from %s\n", path);
+    return 1;
+  }
+  state_t *state = game_init();
+  game_seed(state, header.seed);
+  if (trace_path != NULL) {
+    state->profiler = profiler_init(PROFILE_CAPACITY);
+  }
+
+  size_t next = 0;
+  double start = wall_time();
+  while (true) {
+    while (next < header.num_events && events[next].tick == state->ticks) {
+      game_handle_input(state, events[next]);
+      next++;
+    }
+    if (state->ticks == header.num_ticks) {
+      break;
+    }
+    game_tick(state, FIXED_DT);
+    profile_frame(state->profiler, state->bodies->size, state->contact_pairs);
+  }
+  double elapsed = wall_time() - start;
+  uint64_t checksum = game_checksum(state);
+  if (trace_path != NULL &&
+      profiler_save_trace(state->profiler, trace_path) == false) {
+    fprintf(stderr, "can't write a trace to %s\n", trace_path);
+  }
+
+  printf("ticks,sim_seconds,wall_seconds,speedup,level,egg_health,matches\n");
+  printf("%llu,%.3f,%.6f,%.1f,%zu,%.1f,%s\n",
+         (unsigned long long)state->ticks, state->ticks * FIXED_DT, elapsed,
+         state->ticks * FIXED_DT / elapsed, state->level, state->egg_health,
+         checksum == header.checksum ? "yes" : "no");
+  emscripten_free(state);
+  free(events);
+  return checksum == header.checksum ? 0 : 2;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc > 1 && strcmp(argv[1], "kernels") == 0) {
+    bench_kernels();
+    bench_narrow_phase();
+    return 0;
+  }
+  if (argc > 1 && strcmp(argv[1], "memory") == 0) {
+    run_memory(argc > 2 ? strtoul(argv[2], NULL, 10) : HEADLESS_NUM_LEVELS);
+    return 0;
+  }
+  if (argc > 2 && strcmp(argv[1], "replay") == 0) {
+    return run_replay(argv[2], argc > 3 ? argv[3] : NULL);
+  }
+  if (argc > 2 && strcmp(argv[1], "batch") == 0) {
+    size_t num_seeds = argc > 3 ? strtoul(argv[3], NULL, 10) : BATCH_SEEDS;
+    size_t level = argc > 4 ? strtoul(argv[4], NULL, 10) : BATCH_LEVEL;
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t num_threads = argc > 5   ? strtoul(argv[5], NULL, 10)
+                         : num_cpus > 0 ? (size_t)num_cpus
+                                        : 1;
+    assert(num_seeds > 0 && level > 0 && num_threads > 0);
+    return run_batch(argv[2], num_seeds, level, HEADLESS_DT, num_threads);
+  }
+  bool scaling = argc > 1 && strcmp(argv[1], "scaling") == 0;
+  if (scaling) {
+    argc--;
+    argv++;
+  }
+  size_t num_levels = HEADLESS_NUM_LEVELS;
+  double dt = HEADLESS_DT;
+  size_t num_threads = DEFAULT_NUM_THREADS;
+  if (argc > 1) {
+    num_levels = strtoul(argv[1], NULL, 10);
+  }
+  if (argc > 2) {
+    dt = atof(argv[2]);
+  }
+  if (argc > 3) {
+    num_threads = strtoul(argv[3], NULL, 10);
+  }
+  assert(dt > 0);
+  assert(num_threads > 0);
+
+  double total_ticks, total_wall;
+  if (scaling) {
+    // the same waves on more and more threads
+    printf("threads,ticks,wall_seconds,ticks_per_sec,speedup\n");
+    double base = 0;
+    for (size_t i = 0; i < NUM_SCALING_THREADS; i++) {
+      run_benchmark(num_levels, dt, SCALING_THREADS[i], false, &total_ticks,
+                    &total_wall);
+      double rate = total_ticks / total_wall;
+      base = i == 0 ? rate : base;
+      printf("%zu,%.0f,%.6f,%.1f,%.2f\n", SCALING_THREADS[i], total_ticks,
+             total_wall, rate, rate / base);
+    }
+    return 0;
+  }
+
+  printf("level,bodies,contact_pairs,ticks,sim_seconds,wall_seconds,"
+         "ticks_per_sec\n");
+  run_benchmark(num_levels, dt, num_threads, true, &total_ticks, &total_wall);
+  printf("total,,,%.0f,,%.6f,%.1f\n", total_ticks, total_wall,
+         total_ticks / total_wall);
+  return 0;
+}
+#endif